@@ -0,0 +1,449 @@
+#include <benchmark/benchmark.h>
+#include <fmt/core.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <filesystem>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Chip8.hxx"
+#include "Chip8Rewind.hxx"
+#include "Chip8FrameCache.hxx"
+#include "PerfCounters.hxx"
+#include "WorkloadGenerator.hxx"
+
+// Every benchmark iteration is one emulated instruction unless stated
+// otherwise, so items_per_second is the emulated instruction rate.
+//
+// With CHIP8_BENCH_PERF=1 in the environment the hardware counters from
+// PerfCounters are added to every benchmark, per emulated instruction and,
+// for full ROMs, per frame. Counters the kernel refuses are left out.
+
+static std::shared_ptr<spdlog::logger> benchLogger(void)
+{
+    // Chip8 registers a logger per pid, share one so we can create many CPUs
+    static auto logger = spdlog::stderr_color_mt(fmt::format("{}-bench-chip8", getpid()));
+    return logger;
+}
+
+// Assemble `prologue` once, then `body` repeated `repeat` times followed by a
+// jump back to the first body instruction.
+static std::vector<uint8_t> loopProgram(
+        const std::vector<uint16_t>& prologue, 
+        const std::vector<uint16_t>& body, 
+        unsigned repeat = 64)
+{
+    std::vector<uint8_t> rom;
+    auto emit = [&rom](uint16_t op)
+    {
+        rom.push_back(static_cast<uint8_t>(op >> 8));
+        rom.push_back(static_cast<uint8_t>(op & 0xFF));
+    };
+
+    for (auto op : prologue)
+    {
+        emit(op);
+    }
+    uint16_t loopAddr = static_cast<uint16_t>(Chip8::PROGRAM_START_ADDR + rom.size());
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        for (auto op : body)
+        {
+            emit(op);
+        }
+    }
+    emit(static_cast<uint16_t>(0x1000 | loopAddr));
+
+    return rom;
+}
+
+static std::unique_ptr<PerfCounters> startPerfCounters(void)
+{
+    const char* env = std::getenv("CHIP8_BENCH_PERF");
+    if ((nullptr == env) or (std::string{"1"} != env))
+    {
+        return nullptr;
+    }
+    auto perf = std::make_unique<PerfCounters>();
+    perf->start();
+    return perf;
+}
+
+static void stopPerfCounters(benchmark::State& state, PerfCounters* perf, 
+        uint64_t instructions, uint64_t frames = 0)
+{
+    if (nullptr == perf)
+    {
+        return;
+    }
+    perf->stop();
+    for (std::size_t i = 0; i < PerfCounters::COUNTER_CNT; i++)
+    {
+        auto counter = static_cast<PerfCounters::Counter>(i);
+        if (not perf->isAvailable(counter))
+        {
+            continue;
+        }
+        auto value = static_cast<double>(perf->get(counter));
+        std::string name = PerfCounters::COUNTER_NAMES[i];
+        state.counters[name + "/insn"] = value/static_cast<double>(std::max<uint64_t>(1, instructions));
+        if (0 != frames)
+        {
+            state.counters[name + "/frame"] = value/static_cast<double>(frames);
+        }
+    }
+}
+
+static void runProgram(benchmark::State& state, const std::vector<uint8_t>& rom)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(rom);
+    auto perf = startPerfCounters();
+    for (auto _ : state)
+    {
+        cpu.emulateCycle();
+    }
+    stopPerfCounters(state, perf.get(), state.iterations());
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// 6xkk - the cheapest instruction, measures fetch/decode/dispatch overhead
+static void BM_Dispatch(benchmark::State& state)
+{
+    runProgram(state, loopProgram({}, {0x6012}));
+}
+BENCHMARK(BM_Dispatch);
+
+// 8xyN - arg is N
+static void BM_Alu8xyN(benchmark::State& state)
+{
+    auto n = static_cast<uint16_t>(state.range(0));
+    runProgram(state, loopProgram({0x6155, 0x62AA}, {static_cast<uint16_t>(0x8120 | n)}));
+}
+BENCHMARK(BM_Alu8xyN)->DenseRange(0x0, 0x7)->Arg(0xE);
+
+// 3xkk, 4xkk, 5xy0, 9xy0 - arg is the opcode. Every other skip is taken.
+static void BM_Skip(benchmark::State& state)
+{
+    auto op = static_cast<uint16_t>(state.range(0));
+    state.SetLabel(fmt::format("0x{:04X}", op));
+    runProgram(state, loopProgram({0x6100, 0x6200}, {op}));
+}
+BENCHMARK(BM_Skip)->Arg(0x3100)->Arg(0x4101)->Arg(0x5120)->Arg(0x9120);
+
+// Dxyn - arg is n, sprite is taken from the font area
+static void BM_Drw(benchmark::State& state)
+{
+    auto n = static_cast<uint16_t>(state.range(0));
+    runProgram(state, loopProgram({0xA050, 0x6000, 0x6100}, {static_cast<uint16_t>(0xD010 | n)}));
+}
+BENCHMARK(BM_Drw)->DenseRange(1, 15, 2);
+
+// Cxkk - RND Vx, byte
+static void BM_Rnd(benchmark::State& state)
+{
+    runProgram(state, loopProgram({}, {0xC1FF}));
+}
+BENCHMARK(BM_Rnd);
+
+// Fx33 - LD B, Vx
+static void BM_Bcd(benchmark::State& state)
+{
+    runProgram(state, loopProgram({0xA300, 0x61FF}, {0xF133}));
+}
+BENCHMARK(BM_Bcd);
+
+// Fx55 - LD [I], Vx, arg is x
+static void BM_StoreRegs(benchmark::State& state)
+{
+    auto x = static_cast<uint16_t>(state.range(0));
+    runProgram(state, loopProgram({0xA300}, {static_cast<uint16_t>(0xF055 | (x << 8))}));
+}
+BENCHMARK(BM_StoreRegs)->Arg(0x0)->Arg(0x7)->Arg(0xF);
+
+// Fx65 - LD Vx, [I], arg is x
+static void BM_LoadRegs(benchmark::State& state)
+{
+    auto x = static_cast<uint16_t>(state.range(0));
+    runProgram(state, loopProgram({0xA300}, {static_cast<uint16_t>(0xF065 | (x << 8))}));
+}
+BENCHMARK(BM_LoadRegs)->Arg(0x0)->Arg(0x7)->Arg(0xF);
+
+// Whole programs. Every iteration runs ROM_BATCH_CYCLES cycles and one timer tick.
+static constexpr unsigned ROM_BATCH_CYCLES = 1000;
+
+static void runBatches(benchmark::State& state, Chip8& cpu)
+{
+    auto perf = startPerfCounters();
+    try
+    {
+        for (auto _ : state)
+        {
+            cpu.emulateFrame(ROM_BATCH_CYCLES);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        state.SkipWithError(e.what());
+    }
+    stopPerfCounters(state, perf.get(), state.iterations()*ROM_BATCH_CYCLES, state.iterations());
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()*ROM_BATCH_CYCLES));
+}
+
+static void BM_Rom(benchmark::State& state, const std::string& romPath)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(romPath);
+    runBatches(state, cpu);
+}
+
+// Generated workloads that loop forever, arg is WorkloadGenerator::Kind
+static void BM_Workload(benchmark::State& state)
+{
+    auto kind = static_cast<WorkloadGenerator::Kind>(state.range(0));
+    state.SetLabel(WorkloadGenerator::kindToString(kind));
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({
+                kind, 0, WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    runBatches(state, cpu);
+}
+BENCHMARK(BM_Workload)->DenseRange(
+        static_cast<int>(WorkloadGenerator::Kind::ALU), 
+        static_cast<int>(WorkloadGenerator::Kind::TIMER));
+
+// Every iteration is one snapshot or restore of the whole state, bytes_per_second
+// is the copy bandwidth
+static void BM_SaveState(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    cpu.emulateFrame(ROM_BATCH_CYCLES);
+    Chip8State snapshot;
+    for (auto _ : state)
+    {
+        cpu.saveState(snapshot);
+        benchmark::DoNotOptimize(snapshot);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()*sizeof(Chip8State)));
+}
+BENCHMARK(BM_SaveState);
+
+static void BM_LoadState(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    cpu.emulateFrame(ROM_BATCH_CYCLES);
+    Chip8State snapshot;
+    cpu.saveState(snapshot);
+    for (auto _ : state)
+    {
+        cpu.loadState(snapshot);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()*sizeof(Chip8State)));
+}
+BENCHMARK(BM_LoadState);
+
+// Arg 0 hashes a state with nothing changed since the last call, which is
+// the registers only, arg 1 loads the state first so every block is hashed
+static void BM_StateHash(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    cpu.emulateFrame(ROM_BATCH_CYCLES);
+    Chip8State snapshot;
+    cpu.saveState(snapshot);
+    const bool isFull = (0 != state.range(0));
+    for (auto _ : state)
+    {
+        if (isFull)
+        {
+            cpu.loadState(snapshot);
+        }
+        benchmark::DoNotOptimize(cpu.stateHash());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StateHash)->Arg(0)->Arg(1);
+
+// A fork with no memory written since the previous one shares every page,
+// this is the cost of the eager copy and the page references
+static void BM_Fork(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    cpu.emulateFrame(ROM_BATCH_CYCLES);
+    Chip8Fork child;
+    cpu.fork(child);
+    for (auto _ : state)
+    {
+        cpu.fork(child);
+        benchmark::DoNotOptimize(child);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_Fork);
+
+// Alternates between two siblings that differ in the pages written by one
+// frame of the workload, the inner loop of a search over inputs
+static void BM_LoadFork(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::SMC, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    cpu.emulateFrame(ROM_BATCH_CYCLES);
+    Chip8Fork forks[2];
+    cpu.fork(forks[0]);
+    cpu.emulateFrame(9);
+    cpu.fork(forks[1]);
+    std::size_t next = 0;
+    for (auto _ : state)
+    {
+        cpu.loadFork(forks[next]);
+        next ^= 1;
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["shared_pages"] = static_cast<double>(forks[0].countSharedPages(forks[1]));
+}
+BENCHMARK(BM_LoadFork);
+
+// Every iteration emulates one 540Hz frame and records it, bytes_per_second
+// is the rewind history written
+static void BM_RewindRecord(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    Chip8Rewind rewind;
+    Chip8State snapshot;
+    for (auto _ : state)
+    {
+        cpu.emulateFrame(9);
+        cpu.saveState(snapshot);
+        rewind.record(snapshot);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(rewind.getStats().bytes));
+}
+BENCHMARK(BM_RewindRecord);
+
+// Every iteration steps one frame back, items_per_second is the rewind frame
+// rate the history can be decoded at
+static void BM_RewindStep(benchmark::State& state)
+{
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 0, 
+                WorkloadGenerator::DEFAULT_UNROLL, WorkloadGenerator::DEFAULT_PARAM, 0}).rom);
+    Chip8Rewind rewind;
+    Chip8State snapshot;
+    for (auto _ : state)
+    {
+        if (0 == rewind.getDepth())
+        {
+            state.PauseTiming();
+            for (unsigned frame = 0; frame < 3600; frame++)
+            {
+                cpu.emulateFrame(9);
+                cpu.saveState(snapshot);
+                rewind.record(snapshot);
+            }
+            state.ResumeTiming();
+        }
+        rewind.rewind(1, snapshot);
+        benchmark::DoNotOptimize(snapshot);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_RewindStep);
+
+// An attract mode, a digit blinks every time DT runs out. Every iteration is
+// one frame of range(0) cycles, emulated or, with range(1), from the frame
+// cache, items_per_second is the frame rate.
+static void BM_FrameCache(benchmark::State& state)
+{
+    std::vector<uint8_t> rom;
+    for (uint16_t op : {0xA050, 0x6003, 0xF015, 0xD125, 0xF307, 0x3300, 0x1208, 0x1202})
+    {
+        rom.push_back(static_cast<uint8_t>(op >> 8));
+        rom.push_back(static_cast<uint8_t>(op & 0xFF));
+    }
+    auto cyclesPerFrame = static_cast<unsigned>(state.range(0));
+    const bool isCached = (0 != state.range(1));
+    Chip8 cpu(benchLogger());
+    cpu.loadRom(rom);
+    Chip8FrameCache cache(cyclesPerFrame);
+    for (auto _ : state)
+    {
+        if (isCached)
+        {
+            cache.runFrameCycles(cpu);
+            cpu.decrementTimers();
+        }
+        else
+        {
+            cpu.emulateFrame(cyclesPerFrame);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["hit_rate"] = cache.getHitRate();
+}
+BENCHMARK(BM_FrameCache)->ArgsProduct({{9, 1000}, {0, 1}});
+
+// ROMs come from CHIP8_BENCH_ROM_DIR at runtime or from the directory baked in
+// at configure time
+static void registerRomBenchmarks(void)
+{
+    std::string romDir;
+    if (const char* env = std::getenv("CHIP8_BENCH_ROM_DIR"))
+    {
+        romDir = env;
+    }
+#ifdef BENCH_ROM_DIR
+    else
+    {
+        romDir = BENCH_ROM_DIR;
+    }
+#endif
+    if (romDir.empty() or not std::filesystem::is_directory(romDir))
+    {
+        return;
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(romDir))
+    {
+        if (".ch8" != entry.path().extension())
+        {
+            continue;
+        }
+        std::string romPath = entry.path().string();
+        benchmark::RegisterBenchmark(
+                fmt::format("BM_Rom/{}", entry.path().stem().string()).c_str(), 
+                BM_Rom, romPath);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    registerRomBenchmarks();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
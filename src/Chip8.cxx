@@ -2,6 +2,8 @@
 #include <fstream>
 #include <exception>
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iterator>
 #include <iomanip>
 #include <ios>
@@ -15,6 +17,11 @@
 #include <spdlog/spdlog.h>
 
 #include "Chip8.hxx"
+#include "Chip8Probes.hxx"
+
+static_assert(Chip8State::REGISTER_CNT == Chip8::REGISTER_CNT);
+static_assert(Chip8State::KEYBOARD_SIZE == Chip8::KEYBOARD_SIZE);
+static_assert(Chip8State::GFX_ROWS == Chip8::GFX_ROWS and Chip8State::GFX_COLS == Chip8::GFX_COLS);
 
 /* Chip 8 CPU
  * Note 1: 
@@ -167,13 +174,33 @@ void Chip8::setKey(uint8_t nbr, bool isPressed)
                 );
         throw std::runtime_error(err);
     }
-    m_PreviousKeyboard[nbr] = m_Keyboard[nbr];
-    m_Keyboard[nbr] = isPressed;
+    m_State.previousKeyboard[nbr] = m_State.keyboard[nbr];
+    m_State.keyboard[nbr] = isPressed;
+}
+
+// Bit n is key n
+uint16_t Chip8::getKeys(void) const
+{
+    return static_cast<uint16_t>(m_State.keyboard.to_ulong());
+}
+
+// Only the keys that changed go through setKey(), as if each had its own
+// key event
+void Chip8::setKeys(uint16_t keys)
+{
+    uint16_t changed = static_cast<uint16_t>(keys ^ getKeys());
+    for (uint8_t key = 0; key < KEYBOARD_SIZE; key++)
+    {
+        if (changed & (1U << key))
+        {
+            setKey(key, (keys >> key) & 1);
+        }
+    }
 }
 
 const Bitset2D<Chip8::GFX_ROWS, Chip8::GFX_COLS>& Chip8::getGfx(void) const
 {
-    return m_Gfx;
+    return m_State.gfx;
 }
 
 const std::vector<Chip8::GfxPixelState>& Chip8::getUpdatedPixelsState(void) const
@@ -183,17 +210,48 @@ const std::vector<Chip8::GfxPixelState>& Chip8::getUpdatedPixelsState(void) cons
 
 uint8_t Chip8::getLastGeneratedRnd(void) const
 {
-    return m_rnd;
+    return m_State.rnd;
+}
+
+// The top byte has the best statistics
+uint8_t Chip8::generateRandomUint8(void)
+{
+    return static_cast<uint8_t>(nextRandom() >> 24);
 }
 
-uint8_t Chip8::generateRandomUint8(void) const
+// PCG32 (XSH RR), https://www.pcg-random.org. 16 bytes of state that live in
+// Chip8State, so save states, forks and rewinding restore the sequence too.
+uint32_t Chip8::nextRandom(void)
 {
+    uint64_t old = m_State.rngState;
+    m_State.rngState = old*6364136223846793005ULL + m_State.rngInc;
+    auto xorShifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    auto rot = static_cast<uint32_t>(old >> 59);
+    return (xorShifted >> rot) | (xorShifted << ((-rot) & 31));
+}
 
-    std::random_device device;
-    std::mt19937 generator(device());
-    std::uniform_int_distribution<uint8_t> distribution(0, 255);
+// Restarts the CXkk sequence, a ROM run from reset with the same seed and
+// input always draws the same numbers. Every stream is a different sequence
+// for the same seed, so a fleet can share a seed and take one stream each.
+void Chip8::setRandomSeed(uint64_t seed, uint64_t stream)
+{
+    m_RandomSeed = seed;
+    m_RandomStream = stream;
+    m_State.rngState = 0;
+    m_State.rngInc = (stream << 1) | 1;
+    nextRandom();
+    m_State.rngState += seed;
+    nextRandom();
+}
 
-    return distribution(generator);
+uint64_t Chip8::getRandomSeed(void) const
+{
+    return m_RandomSeed;
+}
+
+uint64_t Chip8::getRandomStream(void) const
+{
+    return m_RandomStream;
 }
 #ifdef TEST_PACKAGE
 void Chip8::writeProgramMemory(uint16_t startAddr, const std::vector<uint8_t>& data)
@@ -218,9 +276,10 @@ void Chip8::writeProgramMemory(uint16_t startAddr, const std::vector<uint8_t>& d
     size_t addr = startAddr;
     for (auto byte : data)
     {
-        m_Memory[addr] = byte;
+        m_State.memory[addr] = byte;
         addr++;
     }
+    markDirty(startAddr, static_cast<uint16_t>(data.size()));
 }
 #endif
 
@@ -237,24 +296,52 @@ std::vector<uint8_t> Chip8::readMemory(uint16_t startAddr, uint16_t endAddr) con
         throw std::runtime_error(err);
     }
 
-    std::vector<uint8_t> ret(m_Memory.begin() + startAddr, m_Memory.begin() + endAddr + 1);
+    std::vector<uint8_t> ret(m_State.memory.begin() + startAddr, m_State.memory.begin() + endAddr + 1);
     return ret;
 }
 
 uint16_t Chip8::getPC() const
 {
-    return m_PC;
+    return m_State.pc;
 }
 uint8_t Chip8::getSP() const
 {
-    return m_SP;
+    return m_State.sp;
 }
 
 // I don't think it is a bad idea to return the whole stack.
 // It is fairly small for
-const std::stack<uint16_t>& Chip8::getStack() const
+std::stack<uint16_t> Chip8::getStack() const
+{
+    std::stack<uint16_t> stack;
+    for (uint8_t i = 0; i < getStackDepth(); i++)
+    {
+        stack.push(m_State.stack[i]);
+    }
+    return stack;
+}
+
+// Return addresses, outermost call first
+void Chip8::getCallStack(std::vector<uint16_t>& returnAddrs) const
+{
+    returnAddrs.assign(m_State.stack.begin(), m_State.stack.begin() + getStackDepth());
+}
+
+// Entries on the stack, SP points at the top one and wraps to 0xFF when empty
+uint8_t Chip8::getStackDepth(void) const
+{
+    return static_cast<uint8_t>(m_State.sp + 1);
+}
+
+// The big endian instruction word at addr, without range checks or copies
+uint16_t Chip8::readOp(uint16_t addr) const
+{
+    return static_cast<uint16_t>((m_State.memory[addr & 0xFFF] << 8) | m_State.memory[(addr + 1) & 0xFFF]);
+}
+
+uint8_t Chip8::readByte(uint16_t addr) const
 {
-    return m_Stack;
+    return m_State.memory[addr & 0xFFF];
 }
 
 uint8_t Chip8::getV(uint8_t nbr) const
@@ -265,12 +352,12 @@ uint8_t Chip8::getV(uint8_t nbr) const
         err += fmt::format("Actual value is 0x{:X}", nbr);
         throw std::runtime_error(err.c_str());
     }
-    return m_V[nbr];
+    return m_State.v[nbr];
 }
 
 uint16_t Chip8::getI(void) const
 {
-    return m_I;
+    return m_State.i;
 }
 
 bool Chip8::getKey(uint8_t nbr) const
@@ -283,30 +370,49 @@ bool Chip8::getKey(uint8_t nbr) const
                 );
         throw std::runtime_error(err);
     }
-    return m_Keyboard[nbr];
+    return m_State.keyboard[nbr];
 }
 
+// Bit n is set once the guest checked key n, until clearKeyReads()
+uint16_t Chip8::getKeyReads(void) const
+{
+    return static_cast<uint16_t>(m_KeyReads.to_ulong());
+}
+
+void Chip8::clearKeyReads(void)
+{
+    m_KeyReads.reset();
+}
+
+// Probes report 0 for the delay and 1 for the sound timer reaching zero
+// Called by the thread that emulates, once per 60Hz frame of emulated time
 void Chip8::decrementTimers(void)
 {
-    if (0 != m_DelayTimer)
+    if (0 != m_State.delayTimer)
     {
-        m_DelayTimer--;
+        if ((0 == --m_State.delayTimer) and not m_IsSpeculative)
+        {
+            CHIP8_PROBE1(timer_expiry, 0);
+        }
     }
 
-    if (0 != m_SoundTimer)
+    if (0 != m_State.soundTimer)
     {
-        m_SoundTimer--;
+        if ((0 == --m_State.soundTimer) and not m_IsSpeculative)
+        {
+            CHIP8_PROBE1(timer_expiry, 1);
+        }
     }
 }
 
 uint8_t Chip8::getDelayTimer()
 {
-    return m_DelayTimer;
+    return m_State.delayTimer;
 }
 
 uint8_t Chip8::getSoundTimer()
 {
-    return m_SoundTimer;
+    return m_State.soundTimer;
 }
 
 // 0nnn - SYS addr
@@ -330,11 +436,14 @@ void Chip8::op_cls(void)
 // The interpreter sets the program counter to the address at the top of the stack, then subtracts 1 from the stack pointer.
 void Chip8::op_ret(void)
 {
-    m_PC = m_Stack.top();
-    m_Stack.pop();
+    if (0 == getStackDepth())
+    {
+        fault(Chip8Fault::Kind::STACK_UNDERFLOW, "RET with an empty stack");
+    }
+    m_State.pc = m_State.stack[m_State.sp];
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_SP -= 1;
+    m_State.sp -= 1;
 #pragma GCC diagnostic pop
 }
 
@@ -344,7 +453,7 @@ void Chip8::op_ret(void)
 // The interpreter sets the program counter to nnn.
 void Chip8::op_jp(void)
 {
-    m_PC = m_nnn;
+    m_State.pc = m_nnn;
 }
 
 // 2nnn - CALL addr
@@ -352,12 +461,17 @@ void Chip8::op_jp(void)
 // The interpreter increments the stack pointer, then puts the current PC on the top of the stack. The PC is then set to nnn.
 void Chip8::op_call(void)
 {
+    if (STACK_SIZE == getStackDepth())
+    {
+        fault(Chip8Fault::Kind::STACK_OVERFLOW, fmt::format(
+                    "CALL 0x{:03X} with {} return addresses on the stack", m_nnn, STACK_SIZE));
+    }
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_SP += 1;
+    m_State.sp += 1;
 #pragma GCC diagnostic pop
-    m_Stack.push(m_PC);
-    m_PC = m_nnn;
+    m_State.stack[m_State.sp] = m_State.pc;
+    m_State.pc = m_nnn;
 }
 
 // 3xkk - SE Vx, byte
@@ -365,7 +479,7 @@ void Chip8::op_call(void)
 // The interpreter compares register Vx to kk, and if they are equal, increments the program counter by 2.
 void Chip8::op_se(void)
 {
-    if (m_kk == m_V[m_x])
+    if (m_kk == m_State.v[m_x])
     {
         incrementPC();
     }
@@ -378,7 +492,7 @@ void Chip8::op_se(void)
 // The interpreter compares register Vx to kk, and if they are not equal, increments the program counter by 2.
 void Chip8::op_sne(void)
 {
-    if (m_kk != m_V[m_x])
+    if (m_kk != m_State.v[m_x])
     {
         incrementPC();
     }
@@ -391,7 +505,7 @@ void Chip8::op_sne(void)
 // The interpreter compares register Vx to register Vy, and if they are equal, increments the program counter by 2.
 void Chip8::op_sker(void)
 {
-    if (m_V[m_y] == m_V[m_x])
+    if (m_State.v[m_y] == m_State.v[m_x])
     {
         incrementPC();
     }
@@ -403,7 +517,7 @@ void Chip8::op_sker(void)
 // The interpreter puts the value kk into register Vx.
 void Chip8::op_ldx(void)
 {
-    m_V[m_x] = m_kk;
+    m_State.v[m_x] = m_kk;
 }
 
 // 7xkk - ADD Vx, byte
@@ -414,7 +528,7 @@ void Chip8::op_add(void)
 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] += m_kk;
+    m_State.v[m_x] += m_kk;
 #pragma GCC diagnostic pop
 }
 
@@ -424,7 +538,7 @@ void Chip8::op_add(void)
 // Stores the value of register Vy in register Vx.
 void Chip8::op_ldr(void)
 {
-    m_V[m_x] = m_V[m_y];
+    m_State.v[m_x] = m_State.v[m_y];
 }
 
 // 8xy1 - OR Vx, Vy
@@ -435,7 +549,7 @@ void Chip8::op_or(void)
 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] |= m_V[m_y];
+    m_State.v[m_x] |= m_State.v[m_y];
 #pragma GCC diagnostic pop
 }
 
@@ -447,7 +561,7 @@ void Chip8::op_and(void)
 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] &= m_V[m_y];
+    m_State.v[m_x] &= m_State.v[m_y];
 #pragma GCC diagnostic pop
 }
 
@@ -459,7 +573,7 @@ void Chip8::op_xor(void)
 {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] ^= m_V[m_y];
+    m_State.v[m_x] ^= m_State.v[m_y];
 #pragma GCC diagnostic pop
 }
 
@@ -469,9 +583,9 @@ void Chip8::op_xor(void)
 // The values of Vx and Vy are added together. If the result is greater than 8 bits (i.e., > 255,) VF is set to 1, otherwise 0. Only the lowest 8 bits of the result are kept, and stored in Vx.
 void Chip8::op_addr(void)
 {
-    uint16_t result = static_cast<uint16_t>(m_V[m_x] + m_V[m_y]);
-    m_V[0xF] = static_cast<uint8_t>(result > 255);
-    m_V[m_x] = static_cast<uint8_t>(result & 0x00FF);
+    uint16_t result = static_cast<uint16_t>(m_State.v[m_x] + m_State.v[m_y]);
+    m_State.v[0xF] = static_cast<uint8_t>(result > 255);
+    m_State.v[m_x] = static_cast<uint8_t>(result & 0x00FF);
 }
 
 // 8xy5 - SUB Vx, Vy
@@ -480,10 +594,10 @@ void Chip8::op_addr(void)
 // If Vx > Vy, then VF is set to 1, otherwise 0. Then Vy is subtracted from Vx, and the results stored in Vx.
 void Chip8::op_sub(void)
 {
-    m_V[0xF] = static_cast<uint8_t>(m_V[m_x] > m_V[m_y]);
+    m_State.v[0xF] = static_cast<uint8_t>(m_State.v[m_x] > m_State.v[m_y]);
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] -= m_V[m_y];
+    m_State.v[m_x] -= m_State.v[m_y];
 #pragma GCC diagnostic pop
 }
 
@@ -493,10 +607,10 @@ void Chip8::op_sub(void)
 // If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
 void Chip8::op_shr(void)
 {
-    m_V[0xF] = m_V[m_x] & 0x01;
+    m_State.v[0xF] = m_State.v[m_x] & 0x01;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] >>= 1;
+    m_State.v[m_x] >>= 1;
 #pragma GCC diagnostic pop
 }
 //
@@ -507,8 +621,8 @@ void Chip8::op_shr(void)
 // If Vy > Vx, then VF is set to 1, otherwise 0. Then Vx is subtracted from Vy, and the results stored in Vx.
 void Chip8::op_subn(void)
 {
-    m_V[0xF] = static_cast<uint8_t>(m_V[m_y] > m_V[m_x]);
-    m_V[m_x] = static_cast<uint8_t>(m_V[m_y] - m_V[m_x]);
+    m_State.v[0xF] = static_cast<uint8_t>(m_State.v[m_y] > m_State.v[m_x]);
+    m_State.v[m_x] = static_cast<uint8_t>(m_State.v[m_y] - m_State.v[m_x]);
 }
 //
 //
@@ -518,10 +632,10 @@ void Chip8::op_subn(void)
 // If the most-significant bit of Vx is 1, then VF is set to 1, otherwise to 0. Then Vx is multiplied by 2.
 void Chip8::op_shl(void)
 {
-    m_V[0xF] = (m_V[m_x] & 0x80) ? 0x01 : 0x00;
+    m_State.v[0xF] = (m_State.v[m_x] & 0x80) ? 0x01 : 0x00;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
-    m_V[m_x] <<= 1;
+    m_State.v[m_x] <<= 1;
 #pragma GCC diagnostic pop
 }
 //
@@ -532,7 +646,7 @@ void Chip8::op_shl(void)
 // The values of Vx and Vy are compared, and if they are not equal, the program counter is increased by 2.
 void Chip8::op_sner(void)
 {
-    if (m_V[m_x] != m_V[m_y])
+    if (m_State.v[m_x] != m_State.v[m_y])
     {
         incrementPC();
     }
@@ -545,7 +659,7 @@ void Chip8::op_sner(void)
 // The value of register I is set to nnn.
 void Chip8::op_ldi(void)
 {
-    m_I = m_nnn;
+    m_State.i = m_nnn;
 }
 //
 //
@@ -555,7 +669,7 @@ void Chip8::op_ldi(void)
 // The program counter is set to nnn plus the value of V0.
 void Chip8::op_jpr(void)
 {
-    m_PC = (m_nnn + m_V[0x0]) & 0xFFF;
+    m_State.pc = (m_nnn + m_State.v[0x0]) & 0xFFF;
 }
 //
 //
@@ -566,8 +680,8 @@ void Chip8::op_jpr(void)
 //
 void Chip8::op_rnd(void)
 {
-    m_rnd = generateRandomUint8();
-    m_V[m_x] = m_rnd & m_kk;
+    m_State.rnd = generateRandomUint8();
+    m_State.v[m_x] = m_State.rnd & m_kk;
 }
 
 // Dxyn - DRW Vx, Vy, nibble
@@ -576,41 +690,56 @@ void Chip8::op_rnd(void)
 // The interpreter reads n bytes from memory, starting at the address stored in I. These bytes are then displayed as sprites on screen at coordinates (Vx, Vy). Sprites are XORed onto the existing screen. If this causes any pixels to be erased, VF is set to 1, otherwise it is set to 0. If the sprite is positioned so part of it is outside the coordinates of the display, it wraps around to the opposite side of the screen. See instruction 8xy3 for more information on XOR, and section 2.4, Display, for more information on the Chip-8 screen and sprites.
 void Chip8::op_drw(void)
 {
-    m_V[0xF] = 0;
+    if (m_State.i + m_n > PROGRAM_END_ADDR + 1)
+    {
+        fault(Chip8Fault::Kind::MEMORY_OUT_OF_BOUNDS, fmt::format(
+                    "Unable to execute 0x{:04X}, sprite at I = 0x{:04X} with {} rows is outside memory",
+                    m_op, m_State.i, m_n));
+    }
+    if (not m_IsSpeculative)
+    {
+        m_Coverage.read(m_State.i, m_n);
+    }
+    m_State.v[0xF] = 0;
     m_UpdatedPixels.clear();
     for (uint8_t spriteRow = 0; spriteRow < m_n; spriteRow++)
     {
         SPDLOG_LOGGER_TRACE(m_Logger, fmt::format("Accessing memory[0x{addr:X}, {addr}]", 
-                    fmt::arg("addr", m_I + spriteRow)));
-        uint8_t spriteByte = m_Memory[m_I + spriteRow];
+                    fmt::arg("addr", m_State.i + spriteRow)));
+        uint8_t spriteByte = m_State.memory[m_State.i + spriteRow];
         for (uint8_t spriteCol = 0; spriteCol < 8; spriteCol++)
         {
             bool spritePixel = (0 == static_cast<uint8_t>(spriteByte & (0x80 >> spriteCol))) ? false : true;
             SPDLOG_LOGGER_TRACE(m_Logger, 
                     fmt::format("Accessing registers {} and {}", m_y, m_x));
-            uint8_t gfxRow = static_cast<uint8_t>((m_V[m_y] + spriteRow) % GFX_ROWS);
-            uint8_t gfxCol = static_cast<uint8_t>((m_V[m_x] + spriteCol) % GFX_COLS);
+            uint8_t gfxRow = static_cast<uint8_t>((m_State.v[m_y] + spriteRow) % GFX_ROWS);
+            uint8_t gfxCol = static_cast<uint8_t>((m_State.v[m_x] + spriteCol) % GFX_COLS);
 
             SPDLOG_LOGGER_TRACE(m_Logger, 
                     "Accessing graphics pixel at row: {} and col: {}", gfxRow, gfxCol);
-            bool oldPixel = m_Gfx(gfxRow, gfxCol);
+            bool oldPixel = m_State.gfx(gfxRow, gfxCol);
             bool newPixel = oldPixel xor spritePixel;
-            m_Gfx(gfxRow, gfxCol) = newPixel;
+            m_State.gfx(gfxRow, gfxCol) = newPixel;
 
             if (oldPixel != newPixel)
             {
                 m_UpdatedPixels.push_back({.row = gfxRow, .col = gfxCol, .isOn = newPixel});
+                m_DirtyRows |= 1U << gfxRow;
             }
 
-            if (0 == m_V[0xF])
+            if (0 == m_State.v[0xF])
             {
                 // set the flag explicilty instead of relying on implicit conversion
                 // of bool to int. i think it makes the code more understandable
-                m_V[0xF] = ((true == oldPixel) and (false == newPixel)) ? 1 : 0;
+                m_State.v[0xF] = ((true == oldPixel) and (false == newPixel)) ? 1 : 0;
             }
         }
     }
     m_IsDrw = true;
+    if (not m_IsSpeculative)
+    {
+        CHIP8_PROBE4(drw, m_State.v[m_x], m_State.v[m_y], m_n, m_State.v[0xF]);
+    }
 }
 
 // Ex9E - SKP Vx
@@ -620,11 +749,12 @@ void Chip8::op_drw(void)
 void Chip8::op_skp(void)
 {
     // the remainder operator, %, makes sure that the
-    // value read from m_V[m_x] is not larger than
+    // value read from m_State.v[m_x] is not larger than
     // the size of the keyboard. another approach
     // would be to generate an exception. for now let's 
     // stick with the remainder
-    if (m_Keyboard[m_V[m_x] % KEYBOARD_SIZE])
+    m_KeyReads.set(m_State.v[m_x] % KEYBOARD_SIZE);
+    if (m_State.keyboard[m_State.v[m_x] % KEYBOARD_SIZE])
     {
         incrementPC();
     }
@@ -637,11 +767,12 @@ void Chip8::op_skp(void)
 void Chip8::op_sknp(void)
 {
     // the remainder operator, %, makes sure that the
-    // value read from m_V[m_x] is not larger than
+    // value read from m_State.v[m_x] is not larger than
     // the size of the keyboard. another approach
     // would be to generate an exception. for now let's 
     // stick with the remainder
-    if (not (m_Keyboard[m_V[m_x] % KEYBOARD_SIZE]))
+    m_KeyReads.set(m_State.v[m_x] % KEYBOARD_SIZE);
+    if (not (m_State.keyboard[m_State.v[m_x] % KEYBOARD_SIZE]))
     {
         incrementPC();
     }
@@ -653,7 +784,7 @@ void Chip8::op_sknp(void)
 // The value of DT is placed into Vx.
 void Chip8::op_ldrdt(void)
 {
-    m_V[m_x] = m_DelayTimer;
+    m_State.v[m_x] = m_State.delayTimer;
 }
 
 // Fx0A - LD Vx, K
@@ -662,15 +793,26 @@ void Chip8::op_ldrdt(void)
 // All execution stops until a key is pressed, then the value of that key is stored in Vx.
 void Chip8::op_ldk(void)
 {
+    if (not m_State.isKeyWait)
+    {
+        if (not m_IsSpeculative)
+        {
+            CHIP8_PROBE2(key_wait_enter, m_OpPC, m_x);
+        }
+        m_State.isKeyWait = true;
+    }
+
+    // every key is looked at until one is released
+    m_KeyReads.set();
     bool isPressed = false;
     for (uint8_t i = 0; i < KEYBOARD_SIZE; i++)
     {
         // https://retrocomputing.stackexchange.com/a/361/21550
         // Based on this post need to check if a key has been released.
         // For now will not do a timer
-        if ((not m_Keyboard[i]) and m_PreviousKeyboard[i])
+        if ((not m_State.keyboard[i]) and m_State.previousKeyboard[i])
         {
-            m_V[m_x] = i;
+            m_State.v[m_x] = i;
             isPressed = true;
             break;
         }
@@ -682,6 +824,14 @@ void Chip8::op_ldk(void)
     {
         decrementPC();
     }
+    else
+    {
+        if (not m_IsSpeculative)
+        {
+            CHIP8_PROBE2(key_wait_exit, m_OpPC, m_State.v[m_x]);
+        }
+        m_State.isKeyWait = false;
+    }
 }
 
 // Fx15 - LD DT, Vx
@@ -690,7 +840,7 @@ void Chip8::op_ldk(void)
 // DT is set equal to the value of Vx.
 void Chip8::op_lddt(void)
 {
-    m_DelayTimer = m_V[m_x];
+    m_State.delayTimer = m_State.v[m_x];
 }
 //
 //
@@ -700,7 +850,7 @@ void Chip8::op_lddt(void)
 // ST is set equal to the value of Vx.
 void Chip8::op_ldst(void)
 {
-    m_SoundTimer = m_V[m_x];
+    m_State.soundTimer = m_State.v[m_x];
 }
 //
 //
@@ -710,7 +860,7 @@ void Chip8::op_ldst(void)
 // The values of I and Vx are added, and the results are stored in I.
 void Chip8::op_addi(void)
 {
-    m_I = (m_I + m_V[m_x]) & 0xFFF;
+    m_State.i = (m_State.i + m_State.v[m_x]) & 0xFFF;
 }
 //
 //
@@ -720,7 +870,7 @@ void Chip8::op_addi(void)
 // The value of I is set to the location for the hexadecimal sprite corresponding to the value of Vx. See section 2.4, Display, for more information on the Chip-8 hexadecimal font.
 void Chip8::op_ldf(void)
 {
-    m_I = static_cast<uint16_t>(FONT_SPRITES_START_ADDR + 5*(m_V[m_x] & 0x0F));
+    m_State.i = static_cast<uint16_t>(FONT_SPRITES_START_ADDR + 5*(m_State.v[m_x] & 0x0F));
 }
 //
 //
@@ -732,22 +882,27 @@ void Chip8::op_ldf(void)
 void Chip8::op_ldb(void)
 {
     // make sure that I, I+1 and I+2 don't go outside the program memory boundaries
-    if ((m_I + 2 > PROGRAM_END_ADDR) || (m_I < PROGRAM_START_ADDR))
+    if ((m_State.i + 2 > PROGRAM_END_ADDR) || (m_State.i < PROGRAM_START_ADDR))
     {
         std::string err = fmt::format(
                 "Unable to execute 0x{op:04X} "
                 "I + 2 = 0x{I:04X} + 2 = 0x{result:04X}. "
                 "Result must be within valid range, [0x{start:03X}, 0x{end:03X}] "
                 ,fmt::arg("op", m_op)
-                ,fmt::arg("I", m_I)
-                ,fmt::arg("result", m_I + 2)
+                ,fmt::arg("I", m_State.i)
+                ,fmt::arg("result", m_State.i + 2)
                 ,fmt::arg("start", PROGRAM_START_ADDR)
                 ,fmt::arg("end", PROGRAM_END_ADDR)
                 );
 
-        throw std::runtime_error(err);
+        fault(Chip8Fault::Kind::MEMORY_OUT_OF_BOUNDS, err);
     }
-    uint8_t value = m_V[m_x];
+    if (not m_IsSpeculative)
+    {
+        m_Coverage.write(m_State.i, 3);
+    }
+    markDirty(m_State.i, 3);
+    uint8_t value = m_State.v[m_x];
 
     uint8_t hundreds = value/100;
     value = static_cast<uint8_t>(value - hundreds*100);
@@ -755,9 +910,9 @@ void Chip8::op_ldb(void)
     uint8_t tens = value/10;
     value = static_cast<uint8_t>(value - tens*10); // what is currently left in value are the units
 
-    m_Memory[m_I] = hundreds;
-    m_Memory[m_I + 1] = tens;
-    m_Memory[m_I + 2] = value;
+    m_State.memory[m_State.i] = hundreds;
+    m_State.memory[m_State.i + 1] = tens;
+    m_State.memory[m_State.i + 2] = value;
 }
 //
 // Fx55 - LD [I], Vx
@@ -767,7 +922,7 @@ void Chip8::op_ldb(void)
 void Chip8::op_ldix(void)
 {
 
-    if ((m_I + m_x > PROGRAM_END_ADDR) || (m_I < PROGRAM_START_ADDR))
+    if ((m_State.i + m_x > PROGRAM_END_ADDR) || (m_State.i < PROGRAM_START_ADDR))
     {
         std::string err = fmt::format(
                 "Unable to execute 0x{op:04X} "
@@ -775,20 +930,25 @@ void Chip8::op_ldix(void)
                 "Result must be within valid range, [0x{start:03X}, 0x{end:03X}] "
                 ,fmt::arg("op", m_op)
                 ,fmt::arg("regX", m_x)
-                ,fmt::arg("I", m_I)
-                ,fmt::arg("valX", m_V[m_x])
-                ,fmt::arg("result", m_I + m_V[m_x])
+                ,fmt::arg("I", m_State.i)
+                ,fmt::arg("valX", m_State.v[m_x])
+                ,fmt::arg("result", m_State.i + m_State.v[m_x])
                 ,fmt::arg("start", PROGRAM_START_ADDR)
                 ,fmt::arg("end", PROGRAM_END_ADDR)
                 );
 
-        throw std::runtime_error(err);
+        fault(Chip8Fault::Kind::MEMORY_OUT_OF_BOUNDS, err);
+    }
+    if (not m_IsSpeculative)
+    {
+        m_Coverage.write(m_State.i, static_cast<uint16_t>(m_x + 1));
     }
+    markDirty(m_State.i, static_cast<uint16_t>(m_x + 1));
 
-    uint16_t addr = m_I;
+    uint16_t addr = m_State.i;
     for (uint8_t i = 0; i <= m_x; i++)
     {
-        m_Memory[addr] = m_V[i];
+        m_State.memory[addr] = m_State.v[i];
         addr++;
     }
 }
@@ -800,7 +960,7 @@ void Chip8::op_ldix(void)
 void Chip8::op_ldxi(void)
 {
     // Allow reading of data before PROGRAM_START.
-    if (m_I + m_x > PROGRAM_END_ADDR)
+    if (m_State.i + m_x > PROGRAM_END_ADDR)
     {
         std::string err = fmt::format(
                 "Unable to execute 0x{op:04X} "
@@ -808,19 +968,23 @@ void Chip8::op_ldxi(void)
                 "Result must be within valid range, [0x0, 0x{end:03X}] "
                 ,fmt::arg("op", m_op)
                 ,fmt::arg("regX", m_x)
-                ,fmt::arg("I", m_I)
-                ,fmt::arg("valX", m_V[m_x])
-                ,fmt::arg("result", m_I + m_V[m_x])
+                ,fmt::arg("I", m_State.i)
+                ,fmt::arg("valX", m_State.v[m_x])
+                ,fmt::arg("result", m_State.i + m_State.v[m_x])
                 ,fmt::arg("end", PROGRAM_END_ADDR)
                 );
 
-        throw std::runtime_error(err);
+        fault(Chip8Fault::Kind::MEMORY_OUT_OF_BOUNDS, err);
+    }
+    if (not m_IsSpeculative)
+    {
+        m_Coverage.read(m_State.i, static_cast<uint16_t>(m_x + 1));
     }
 
-    uint16_t addr = m_I;
+    uint16_t addr = m_State.i;
     for (uint8_t i = 0; i <= m_x; i++)
     {
-        m_V[i] = m_Memory[addr];
+        m_State.v[i] = m_State.memory[addr];
         addr++;
     }
 }
@@ -843,6 +1007,9 @@ Chip8::Chip8(std::shared_ptr<spdlog::logger> logger)
     }
 
     setupOpTbl();
+    // every instance differs unless seeded, as on real hardware
+    m_RandomSeed = std::random_device{}();
+    m_RandomStream = 0;
     reset();
 }
 
@@ -955,14 +1122,18 @@ void Chip8::setupOpFTbl(void)
 
 void Chip8::resetKeyboard(void)
 {
-    m_Keyboard.reset();
-    m_PreviousKeyboard.reset();
+    m_State.keyboard.reset();
+    m_State.previousKeyboard.reset();
+    m_KeyReads.reset();
 }
 
 void Chip8::reset(void)
 {
     m_IsDrw = false;
-    m_CycleCnt = 0;
+    m_State.isKeyWait = false;
+    m_State.cycleCnt = 0;
+    // part of stateHash(), a reset machine has to hash like a new one
+    m_State.rnd = 0;
 
     resetKeyboard();
     resetPC();
@@ -971,22 +1142,226 @@ void Chip8::reset(void)
     resetTimers();
     resetMemory();
     resetGfx();
+    m_FlightRecorder.reset();
+    m_Coverage.reset();
+    m_RomHash = hashBytes(nullptr, 0);
+    setRandomSeed(m_RandomSeed, m_RandomStream);
+#ifdef PROFILER_PACKAGE
+    m_Profiler.reset();
+#endif
 }
 
 void Chip8::resetGfx(void)
 {
-    m_Gfx.reset();
+    m_State.gfx.reset();
+    m_DirtyRows = ~0U;
 }
 
 void Chip8::emulateCycle(void)
 {
     m_IsDrw = false;
 
-    fetchOp();
-    incrementPC();
-    executeOp();
+    try
+    {
+        fetchOp();
+        if (not m_IsSpeculative)
+        {
+            m_FlightRecorder.record(m_OpPC, m_op, m_State.i, m_State.v[0xF]);
+            m_Coverage.execute(m_OpPC);
+#ifdef PROFILER_PACKAGE
+            m_Profiler.record(m_State.pc, m_op);
+#endif
+        }
+        incrementPC();
+        executeOp();
+    }
+    catch (const Chip8Fault& e)
+    {
+        if (not m_IsSpeculative)
+        {
+            writeCrashDump(e);
+        }
+        throw;
+    }
+
+    m_State.cycleCnt++;
+}
+
+// One frame is a batch of cycles followed by a single 60Hz timer tick. Driving
+// the timers from here instead of the wall clock makes runs reproducible.
+void Chip8::emulateFrame(unsigned cyclesPerFrame)
+{
+    for (unsigned cnt = 0; cnt < cyclesPerFrame; cnt++)
+    {
+        emulateCycle();
+    }
+    decrementTimers();
+}
 
-    m_CycleCnt++;
+uint64_t Chip8::getCycleCount(void) const
+{
+    return m_State.cycleCnt;
+}
+
+// A plain copy of the state, no allocations. Call from the thread that
+// emulates and ticks the timers, between cycles.
+void Chip8::saveState(Chip8State& state) const
+{
+    state = m_State;
+}
+
+// The screen changes wholesale, callers redraw it from getGfx()
+void Chip8::loadState(const Chip8State& state)
+{
+    m_State = state;
+    if (0 == m_State.rngInc)
+    {
+        // saved before the generator was part of the state
+        setRandomSeed(m_RandomSeed, m_RandomStream);
+    }
+    m_OpPC = m_State.pc;
+    m_IsDrw = false;
+    m_UpdatedPixels.clear();
+    m_DirtyPages = ALL_PAGES_DIRTY;
+    m_DirtyBlocks = ~0ULL;
+    m_DirtyRows = ~0U;
+}
+
+// Pages written since the last fork are published as new shared pages, the
+// others are already shared with the earlier forks
+void Chip8::fork(Chip8Fork& child)
+{
+    while (0 != m_DirtyPages)
+    {
+        auto page = static_cast<std::size_t>(std::countr_zero(m_DirtyPages));
+        auto copy = std::make_shared<Chip8Fork::Page>();
+        std::memcpy(copy->data(), &m_State.memory[page*Chip8Fork::PAGE_SIZE_B], Chip8Fork::PAGE_SIZE_B);
+        m_Pages[page] = std::move(copy);
+        m_DirtyPages = static_cast<uint16_t>(m_DirtyPages & (m_DirtyPages - 1));
+    }
+    child.pages = m_Pages;
+    std::memcpy(child.cpu.data(), reinterpret_cast<const uint8_t*>(&m_State) + Chip8Fork::CPU_OFFSET,
+            Chip8Fork::CPU_SIZE_B);
+}
+
+// Only the pages that differ from the ones in memory are copied, going from
+// one fork to a sibling of it copies what the two of them wrote
+void Chip8::loadFork(const Chip8Fork& fork)
+{
+    if (nullptr == fork.pages[0])
+    {
+        throw std::runtime_error("Unable to load a fork that was never forked from a Chip8");
+    }
+    for (std::size_t page = 0; page < Chip8Fork::PAGE_CNT; page++)
+    {
+        if ((m_Pages[page] != fork.pages[page]) or (m_DirtyPages & (1U << page)))
+        {
+            std::memcpy(&m_State.memory[page*Chip8Fork::PAGE_SIZE_B], fork.pages[page]->data(),
+                    Chip8Fork::PAGE_SIZE_B);
+            m_Pages[page] = fork.pages[page];
+            markDirty(static_cast<uint16_t>(page*Chip8Fork::PAGE_SIZE_B), Chip8Fork::PAGE_SIZE_B);
+        }
+    }
+    m_DirtyPages = 0;
+    // the screen leads the eagerly copied part, rows that stay the same keep
+    // their hash
+    const auto* gfx = reinterpret_cast<const uint8_t*>(&m_State.gfx);
+    for (std::size_t row = 0; row < GFX_ROWS; row++)
+    {
+        if (0 != std::memcmp(gfx + row*GFX_ROW_SIZE_B, fork.cpu.data() + row*GFX_ROW_SIZE_B, GFX_ROW_SIZE_B))
+        {
+            m_DirtyRows |= 1U << row;
+        }
+    }
+    std::memcpy(reinterpret_cast<uint8_t*>(&m_State) + Chip8Fork::CPU_OFFSET, fork.cpu.data(),
+            Chip8Fork::CPU_SIZE_B);
+    m_OpPC = m_State.pc;
+    m_IsDrw = false;
+    m_UpdatedPixels.clear();
+}
+
+// Every memory write goes through here, so the next fork() knows which pages
+// it has to copy and the next stateHash() which blocks it has to hash
+void Chip8::markDirty(uint16_t addr, uint16_t len)
+{
+    if (0 == len)
+    {
+        return;
+    }
+    constexpr std::size_t blocksPerPage = Chip8Fork::PAGE_SIZE_B/HASH_BLOCK_SIZE_B;
+    std::size_t first = (addr & 0xFFF)/HASH_BLOCK_SIZE_B;
+    std::size_t last = ((addr + len - 1) & 0xFFF)/HASH_BLOCK_SIZE_B;
+    for (std::size_t block = first; ; block = (block + 1) % HASH_BLOCK_CNT)
+    {
+        m_DirtyBlocks |= 1ULL << block;
+        m_DirtyPages = static_cast<uint16_t>(m_DirtyPages | (1U << (block/blocksPerPage)));
+        if (block == last)
+        {
+            break;
+        }
+    }
+}
+
+// Hash of everything that decides what the machine does next: memory, screen,
+// registers, the live part of the stack, timers, keyboard and the random
+// generator. The cycle count is left out, so the same state reached at
+// different times hashes the same. Costs a hash of the 64 byte blocks and
+// screen rows changed since the last call.
+uint64_t Chip8::stateHash(void)
+{
+    const auto* memory = m_State.memory.data();
+    for (; 0 != m_DirtyBlocks; m_DirtyBlocks &= m_DirtyBlocks - 1)
+    {
+        auto block = static_cast<std::size_t>(std::countr_zero(m_DirtyBlocks));
+        uint64_t hash = hashBlock(memory + block*HASH_BLOCK_SIZE_B, HASH_BLOCK_SIZE_B, block);
+        m_MemoryHash += hash - m_BlockHashes[block];
+        m_BlockHashes[block] = hash;
+    }
+
+    const auto* gfx = reinterpret_cast<const uint8_t*>(&m_State.gfx);
+    for (; 0 != m_DirtyRows; m_DirtyRows &= m_DirtyRows - 1)
+    {
+        auto row = static_cast<std::size_t>(std::countr_zero(m_DirtyRows));
+        uint64_t hash = hashBlock(gfx + row*GFX_ROW_SIZE_B, GFX_ROW_SIZE_B, HASH_BLOCK_CNT + row);
+        m_GfxHash += hash - m_RowHashes[row];
+        m_RowHashes[row] = hash;
+    }
+
+    // registers are hashed every time, from V0 up to and including
+    // isKeyWait and without the padding after it, then the generator
+    constexpr std::size_t cpuOffset = offsetof(Chip8State, v);
+    constexpr std::size_t cpuSize = offsetof(Chip8State, isKeyWait) + sizeof(bool) - cpuOffset;
+    uint64_t cpuHash = hashBlock(reinterpret_cast<const uint8_t*>(&m_State) + cpuOffset, cpuSize,
+            HASH_BLOCK_CNT + GFX_ROWS);
+    const uint64_t rng[] = {m_State.rngState, m_State.rngInc};
+    uint64_t rngHash = hashBlock(reinterpret_cast<const uint8_t*>(rng), sizeof(rng), HASH_BLOCK_CNT + GFX_ROWS + 1);
+    // only the live part of the stack, RET leaves the popped entries behind
+    std::array<uint16_t, STACK_SIZE> stack{};
+    std::copy_n(m_State.stack.begin(), std::min<std::size_t>(getStackDepth(), STACK_SIZE), stack.begin());
+    uint64_t stackHash = hashBlock(reinterpret_cast<const uint8_t*>(stack.data()), sizeof(stack),
+            HASH_BLOCK_CNT + GFX_ROWS + 2);
+
+    return m_MemoryHash + m_GfxHash + cpuHash + rngHash + stackHash;
+}
+
+// 8 bytes per multiply, the seed tells apart equal bytes in different blocks
+uint64_t Chip8::hashBlock(const uint8_t* data, std::size_t size, uint64_t seed)
+{
+    uint64_t hash = (seed + 1) * 0x9E3779B97F4A7C15ULL;
+    std::size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    hash = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 33);
 }
 
 void Chip8::executeOp(void)
@@ -1002,24 +1377,35 @@ void Chip8::executeOp(void)
                 "Unsupported opcode: 0x{:04X}", m_op
                 );
 
-        m_Logger->error(err);
-        throw;
+        if (not m_IsSpeculative)
+        {
+            m_Logger->error(err);
+            CHIP8_PROBE2(illegal_opcode, m_OpPC, m_op);
+        }
+        fault(Chip8Fault::Kind::ILLEGAL_OPCODE, err);
     }
 }
 
 void Chip8::incrementPC(void)
 {
-    m_PC = (m_PC + INSTRUCTION_SIZE_B) & 0x0FFF;
+    m_State.pc = (m_State.pc + INSTRUCTION_SIZE_B) & 0x0FFF;
 }
 
 void Chip8::decrementPC(void)
 {
-    m_PC = (m_PC - INSTRUCTION_SIZE_B) & 0xFFF;
+    m_State.pc = (m_State.pc - INSTRUCTION_SIZE_B) & 0xFFF;
 }
 
 void Chip8::fetchOp(void)
 {
-    m_op = static_cast<uint16_t>((m_Memory[m_PC] << 8 ) | m_Memory[m_PC + 1]);
+    m_OpPC = m_State.pc;
+    if (m_State.pc > PROGRAM_END_ADDR - 1)
+    {
+        m_op = static_cast<uint16_t>(m_State.memory[m_State.pc] << 8);
+        fault(Chip8Fault::Kind::MEMORY_OUT_OF_BOUNDS, fmt::format(
+                    "Unable to fetch an instruction at PC = 0x{:03X}", m_State.pc));
+    }
+    m_op = static_cast<uint16_t>((m_State.memory[m_State.pc] << 8 ) | m_State.memory[m_State.pc + 1]);
 
     // decode op
     m_OpId = static_cast<uint8_t>((m_op & 0xF000) >> 12);
@@ -1032,26 +1418,26 @@ void Chip8::fetchOp(void)
 
 void Chip8::resetTimers(void)
 {
-    m_DelayTimer = 0;
-    m_SoundTimer = 0;
+    m_State.delayTimer = 0;
+    m_State.soundTimer = 0;
 }
 
 void Chip8::resetRegisters(void)
 {
-    m_V.resize(REGISTER_CNT);
-    std::fill(m_V.begin(), m_V.end(), REGISTER_RESET_VALUE);
-    m_I = REGISTER_I_RESET_VALUE;
+    m_State.v.fill(REGISTER_RESET_VALUE);
+    m_State.i = REGISTER_I_RESET_VALUE;
 }
 
 void Chip8::resetStack(void)
 {
-    m_Stack = std::stack<uint16_t>();
-    m_SP = -1;
+    m_State.stack.fill(0);
+    m_State.sp = SP_RESET_VALUE;
 }
 
 void Chip8::resetPC(void)
 {
-    m_PC = PROGRAM_START_ADDR;
+    m_State.pc = PROGRAM_START_ADDR;
+    m_OpPC = m_State.pc;
 }
 
 void Chip8::loadRom(const std::string& filename)
@@ -1073,15 +1459,51 @@ void Chip8::loadRom(const std::string& filename)
     // not ignore whitespace, but based on my online reading it doesn't always happen.
     rom.unsetf(std::ios::skipws);
 
-    rom.read(reinterpret_cast<char *>(&m_Memory[PROGRAM_START_ADDR]), PROGRAM_END_ADDR - PROGRAM_START_ADDR + 1);
+    rom.read(reinterpret_cast<char *>(&m_State.memory[PROGRAM_START_ADDR]), PROGRAM_END_ADDR - PROGRAM_START_ADDR + 1);
+    m_RomHash = hashBytes(&m_State.memory[PROGRAM_START_ADDR], static_cast<std::size_t>(rom.gcount()));
+    markDirty(PROGRAM_START_ADDR, static_cast<uint16_t>(rom.gcount()));
+}
+// Same as loading from a file, but for programs that were generated or
+// assembled in memory
+void Chip8::loadRom(const std::vector<uint8_t>& rom)
+{
+    constexpr std::size_t maxRomSize = PROGRAM_END_ADDR - PROGRAM_START_ADDR + 1;
+    if (rom.size() > maxRomSize)
+    {
+        throw std::runtime_error(fmt::format(
+                    "Rom is {} bytes, maximum rom size is {} bytes", rom.size(), maxRomSize));
+    }
+    std::copy(rom.begin(), rom.end(), m_State.memory.begin() + PROGRAM_START_ADDR);
+    markDirty(PROGRAM_START_ADDR, static_cast<uint16_t>(rom.size()));
+    m_RomHash = hashBytes(rom.data(), rom.size());
+}
+
+// Identifies the program for save states, the same bytes always hash the same
+uint64_t Chip8::getRomHash(void) const
+{
+    return m_RomHash;
+}
+
+// 64-bit FNV-1a, same as gfxHash()
+uint64_t Chip8::hashBytes(const uint8_t* data, std::size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
 }
+
 void Chip8::resetMemory(void)
 {
     // do this in case large rom was loaded. this is a precaution.
-    std::fill(m_Memory.begin(), m_Memory.begin() + FONT_SPRITES_START_ADDR, MEMORY_RESET_VALUE);
-    std::fill(m_Memory.begin() + FONT_SPRITES_END_ADDR + 1, m_Memory.end(), MEMORY_RESET_VALUE);
+    std::fill(m_State.memory.begin(), m_State.memory.begin() + FONT_SPRITES_START_ADDR, MEMORY_RESET_VALUE);
+    std::fill(m_State.memory.begin() + FONT_SPRITES_END_ADDR + 1, m_State.memory.end(), MEMORY_RESET_VALUE);
 
     loadFont();
+    m_DirtyPages = ALL_PAGES_DIRTY;
+    m_DirtyBlocks = ~0ULL;
 }
 
 void Chip8::loadFont(void)
@@ -1091,7 +1513,7 @@ void Chip8::loadFont(void)
     {
         for (auto byte : sprite)
         {
-            m_Memory[memoryOffset] = byte;
+            m_State.memory[memoryOffset] = byte;
             memoryOffset++;
         }
     }
@@ -1102,6 +1524,19 @@ bool Chip8::isDrw() const
     return m_IsDrw;
 }
 
+// True when the next instruction is a jump to itself. Nothing but the
+// timers can change after that, this is how most ROMs end.
+bool Chip8::isHalted() const
+{
+    return (0x1000 | m_State.pc) == readOp(m_State.pc);
+}
+
+// Fx0A is waiting for a key, execution doesn't progress until one is released
+bool Chip8::isKeyWait() const
+{
+    return m_State.isKeyWait;
+}
+
 std::string Chip8::gfxString() const
 {
     // need extra GFX_ROWS-1  for new lines
@@ -1114,7 +1549,7 @@ std::string Chip8::gfxString() const
     {
         for(std::size_t col = 0; col < GFX_COLS; col++)
         {
-            output[row*GFX_COLS + col + strOffset] = m_Gfx(row, col) ? '*' : ' ';
+            output[row*GFX_COLS + col + strOffset] = m_State.gfx(row, col) ? '*' : ' ';
         }
         strOffset++;
     }
@@ -1122,6 +1557,121 @@ std::string Chip8::gfxString() const
     return output;
 }
 
+// FNV-1a over the framebuffer, 8 pixels per byte. Cheap enough to compare
+// frames between runs without dumping the whole gfxString().
+uint64_t Chip8::gfxHash() const
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (std::size_t row = 0; row < GFX_ROWS; row++)
+    {
+        for (std::size_t col = 0; col < GFX_COLS; col += 8)
+        {
+            uint8_t byte = 0;
+            for (std::size_t bit = 0; bit < 8; bit++)
+            {
+                byte = static_cast<uint8_t>((byte << 1) | (m_State.gfx(row, col + bit) ? 1 : 0));
+            }
+            hash = (hash ^ byte) * 0x100000001B3ULL;
+        }
+    }
+
+    return hash;
+}
+
+void Chip8::writeProfileReport(std::ostream& os) const
+{
+#ifdef PROFILER_PACKAGE
+    m_Profiler.report(os, m_State.memory);
+#else
+    os << "Profiler is not compiled in, configure with -DBUILD_PROFILER_PACKAGE=ON\n";
+#endif
+}
+
+// Writes <basePath>.pgm and <basePath>.csv, throws unless compiled with
+// -DBUILD_COVERAGE_PACKAGE=ON
+void Chip8::writeCoverage(const std::string& basePath) const
+{
+    m_Coverage.save(basePath);
+}
+
+// Where the dump of the next fault goes, an empty path disables it
+void Chip8::setCrashDumpPath(const std::string& path)
+{
+    m_CrashDumpPath = path;
+}
+
+// Speculative cycles are about to be thrown away by a loadFork() or
+// loadState(): the flight recorder, coverage, profiler and probes do not see
+// them and a fault neither logs nor writes a crash dump, it is only thrown
+void Chip8::setSpeculative(bool isSpeculative)
+{
+    m_IsSpeculative = isSpeculative;
+}
+
+bool Chip8::isSpeculative(void) const
+{
+    return m_IsSpeculative;
+}
+
+// Full machine state followed by the last executed instructions
+void Chip8::writeCrashReport(std::ostream& os) const
+{
+    os << fmt::format("cycles: {}\n", m_State.cycleCnt);
+    os << fmt::format("PC: 0x{:03X}\n", m_State.pc);
+    os << fmt::format("I: 0x{:03X}\n", m_State.i);
+    os << fmt::format("SP: 0x{:02X}\n", m_State.sp);
+    os << fmt::format("DT: 0x{:02X}\n", m_State.delayTimer);
+    os << fmt::format("ST: 0x{:02X}\n", m_State.soundTimer);
+    for (uint8_t i = 0; i < REGISTER_CNT; i++)
+    {
+        os << fmt::format("V{:X}: 0x{:02X}\n", i, m_State.v[i]);
+    }
+    std::vector<uint16_t> returnAddrs;
+    getCallStack(returnAddrs);
+    os << "stack:";
+    for (auto addr : returnAddrs)
+    {
+        os << fmt::format(" 0x{:03X}", addr);
+    }
+    os << fmt::format("\nkeys: 0b{:016b}\n", m_State.keyboard.to_ulong());
+    os << fmt::format("gfx_hash: 0x{:016X}\n", gfxHash());
+
+    os << "\nmemory:\n";
+    for (uint16_t addr = 0; addr < MEMORY_SIZE_B; addr += 16)
+    {
+        os << fmt::format("0x{:03X}:", addr);
+        for (uint16_t i = 0; i < 16; i++)
+        {
+            os << fmt::format(" {:02X}", m_State.memory[addr + i]);
+        }
+        os << "\n";
+    }
+
+    os << fmt::format("\nlast {} instructions, oldest first:\n", 
+            std::min<uint64_t>(m_FlightRecorder.getEntryCount(), Chip8FlightRecorder::ENTRY_CNT));
+    m_FlightRecorder.dump(os);
+}
+
+void Chip8::fault(Chip8Fault::Kind kind, const std::string& what) const
+{
+    throw Chip8Fault(kind, m_OpPC, m_op, what);
+}
+
+void Chip8::writeCrashDump(const Chip8Fault& e) const
+{
+    if (m_CrashDumpPath.empty())
+    {
+        return;
+    }
+    std::ofstream dump(m_CrashDumpPath);
+    dump << fmt::format("fault: {}\n", Chip8Fault::kindToString(e.getKind()));
+    dump << fmt::format("what: {}\n", e.what());
+    dump << fmt::format("fault_pc: 0x{:03X}\n", e.getPC());
+    dump << fmt::format("fault_op: 0x{:04X}\n", e.getOp());
+    writeCrashReport(dump);
+    m_Logger->error("Crash dump written to {}", m_CrashDumpPath);
+}
+
 void Chip8::displayOp(void) const
 {
     SPDLOG_LOGGER_TRACE(m_Logger, 
@@ -1152,11 +1702,11 @@ void Chip8::displayRegisters(void) const
         // See Note 1 in the beginning on this file to read on why I'm using lambda here.
         [&]()
         {
-            std::string result = fmt::format(fmt::format("\nPC = 0x{:>03X}", m_PC));
-            result += fmt::format("\nSP = {}", m_SP);
-            for (decltype(m_V.size()) i = 0; i < m_V.size(); i++)
+            std::string result = fmt::format(fmt::format("\nPC = 0x{:>03X}", m_State.pc));
+            result += fmt::format("\nSP = {}", m_State.sp);
+            for (std::size_t i = 0; i < m_State.v.size(); i++)
             {
-                result += fmt::format("\nV[0x{:>01X}] = 0x{:>02X}", i, m_V[i]);
+                result += fmt::format("\nV[0x{:>01X}] = 0x{:>02X}", i, m_State.v[i]);
             }
             // remove last character, new line, '\n'
             result.pop_back();
@@ -1222,7 +1772,7 @@ void Chip8::displayMemoryContents(
                 }
 
                 // display memory contents
-                result += fmt::format("0x{:02X} ", m_Memory[i]);
+                result += fmt::format("0x{:02X} ", m_State.memory[i]);
             }
             return result;
         }()
@@ -9,8 +9,17 @@
 #include <spdlog/logger.h>
 #include <chrono>
 #include <mutex>
+#include <ostream>
     
 #include "Bitset2D.txx"
+#include "Chip8State.hxx"
+#include "Chip8Fork.hxx"
+#include "Chip8Fault.hxx"
+#include "Chip8FlightRecorder.hxx"
+#include "Chip8Coverage.hxx"
+#ifdef PROFILER_PACKAGE
+#include "Chip8Profiler.hxx"
+#endif
 
 
 using namespace std::chrono_literals;
@@ -29,16 +38,32 @@ class Chip8
     static constexpr uint8_t GFX_COLS = 64;
 
     static constexpr std::chrono::duration<float> TIMER_PERIOD_mS = 16.667ms;
+    static constexpr unsigned TIMER_HZ = 60;
 
     Chip8(std::shared_ptr<spdlog::logger> logger = nullptr);
     const Bitset2D<GFX_ROWS, GFX_COLS>& getGfx(void) const;
     const std::vector<GfxPixelState>& getUpdatedPixelsState(void) const;
     uint8_t getLastGeneratedRnd(void) const;
+    void setRandomSeed(uint64_t seed, uint64_t stream = 0);
+    uint64_t getRandomSeed(void) const;
+    uint64_t getRandomStream(void) const;
     void loadRom(const std::string& filename);
+    void loadRom(const std::vector<uint8_t>& rom);
     void displayState(void) const;
+    void writeProfileReport(std::ostream& os) const;
+    void writeCoverage(const std::string& basePath) const;
+    void writeCrashReport(std::ostream& os) const;
+    void setCrashDumpPath(const std::string& path);
+    void setSpeculative(bool isSpeculative);
+    bool isSpeculative(void) const;
     void displayMemoryContents(uint16_t startAddr = 0x0, uint16_t endAddr = 0xFFF) const;
     std::string gfxString() const;
+    uint64_t gfxHash() const;
+    uint64_t stateHash(void);
+    uint64_t getRomHash(void) const;
     bool isDrw(void) const;
+    bool isHalted(void) const;
+    bool isKeyWait(void) const;
     void reset(void);
     void run(void);
     std::vector<uint8_t> readMemory(uint16_t startAddr, uint16_t endAddr) const;
@@ -47,16 +72,29 @@ class Chip8
 #endif
     uint16_t getPC() const;
     uint8_t getSP() const;
-    const std::stack<uint16_t>& getStack() const;
+    std::stack<uint16_t> getStack() const;
+    void getCallStack(std::vector<uint16_t>& returnAddrs) const;
+    uint16_t readOp(uint16_t addr) const;
+    uint8_t readByte(uint16_t addr) const;
     uint8_t getV(uint8_t nbr) const;
     uint16_t getI(void) const;
     bool getKey(uint8_t nbr) const;
     void setKey(uint8_t nbr, bool isPressed);
+    uint16_t getKeys(void) const;
+    void setKeys(uint16_t keys);
+    uint16_t getKeyReads(void) const;
+    void clearKeyReads(void);
     uint8_t getDelayTimer(void);
     uint8_t getSoundTimer(void);
     void decrementTimers(void);
 
     void emulateCycle(void);
+    void emulateFrame(unsigned cyclesPerFrame);
+    uint64_t getCycleCount(void) const;
+    void saveState(Chip8State& state) const;
+    void loadState(const Chip8State& state);
+    void fork(Chip8Fork& child);
+    void loadFork(const Chip8Fork& fork);
 
     static constexpr uint16_t PROGRAM_START_ADDR = 0x200; // 512
     static constexpr uint16_t PROGRAM_END_ADDR = 0xFFF; // 4095
@@ -90,17 +128,31 @@ class Chip8
     // 0x050-0x09F - Used for the built in 8x5 pixel font set (0-F)
     // 0x200-0xFFF - Program ROM and work RAM
 
-    static constexpr uint16_t MEMORY_SIZE_B = 4096;
+    static constexpr uint16_t MEMORY_SIZE_B = Chip8State::MEMORY_SIZE_B;
     static constexpr uint16_t REGISTER_I_RESET_VALUE = 0;
     static constexpr uint8_t MEMORY_RESET_VALUE = 0;
     static constexpr uint16_t DISPLAY_REFRESH_START_ADDR = 0xF00;
     static constexpr uint16_t DISPLAY_REFRESH_END_ADDR = 0xEFF;
     // static constexpr uint16_t STACK_START_ADDR = 0xEA0;
     // static constexpr uint16_t STACK_END_ADDR = 0xEFF;
-    static constexpr uint8_t STACK_SIZE = 16;
+    static constexpr uint8_t STACK_SIZE = Chip8State::STACK_SIZE;
     static constexpr bool GFX_RESET_VALUE = false;
+    static constexpr uint16_t ALL_PAGES_DIRTY = static_cast<uint16_t>((1U << Chip8Fork::PAGE_CNT) - 1);
+    // stateHash() granularity
+    static constexpr std::size_t HASH_BLOCK_SIZE_B = 64;
+    static constexpr std::size_t HASH_BLOCK_CNT = MEMORY_SIZE_B/HASH_BLOCK_SIZE_B;
+    static constexpr std::size_t GFX_ROW_SIZE_B = sizeof(Bitset2D<GFX_ROWS, GFX_COLS>)/GFX_ROWS;
+    static_assert(HASH_BLOCK_CNT <= 64, "Dirty hash blocks are tracked in 64 bits");
+    static_assert(GFX_ROWS <= 32, "Dirty rows are tracked in 32 bits");
 
-    uint8_t generateRandomUint8(void) const;
+    uint8_t generateRandomUint8(void);
+    uint32_t nextRandom(void);
+    uint8_t getStackDepth(void) const;
+    static uint64_t hashBytes(const uint8_t* data, std::size_t size);
+    static uint64_t hashBlock(const uint8_t* data, std::size_t size, uint64_t seed);
+    void markDirty(uint16_t addr, uint16_t len);
+    [[noreturn]] void fault(Chip8Fault::Kind kind, const std::string& what) const;
+    void writeCrashDump(const Chip8Fault& e) const;
 
     void fetchOp(void);
     void executeOp(void);
@@ -172,27 +224,44 @@ class Chip8
     std::unordered_map<uint8_t, InstructionHandler> m_opE_tbl;
     std::unordered_map<uint8_t, InstructionHandler> m_opF_tbl;
 
-    uint64_t m_CycleCnt;
-    std::bitset<KEYBOARD_SIZE> m_Keyboard;
-    std::bitset<KEYBOARD_SIZE> m_PreviousKeyboard;
+    // registers, stack, timers, memory, screen and keyboard
+    Chip8State m_State{};
+    // keys the guest looked at with Ex9E, ExA1 or Fx0A since clearKeyReads()
+    std::bitset<KEYBOARD_SIZE> m_KeyReads;
     bool m_IsDrw;
-    std::array<uint8_t, MEMORY_SIZE_B> m_Memory;
-    uint8_t m_SP;
-    uint16_t m_PC;
-    std::vector<uint8_t> m_V;
-    uint16_t m_I;
-    std::stack<uint16_t> m_Stack;
     uint16_t m_op;
+    uint16_t m_OpPC;
     uint8_t m_x;
     uint8_t m_y;
     uint8_t m_n;
     uint8_t m_kk;
-    uint8_t m_rnd;
     uint16_t m_nnn;
     uint8_t m_OpId;
-    std::atomic<uint8_t> m_DelayTimer;
-    std::atomic<uint8_t> m_SoundTimer;
-    Bitset2D<GFX_ROWS, GFX_COLS> m_Gfx;
     std::vector<GfxPixelState> m_UpdatedPixels;
+    Chip8FlightRecorder m_FlightRecorder;
+    [[no_unique_address]] Chip8CoveragePolicy m_Coverage;
+    std::string m_CrashDumpPath;
+    bool m_IsSpeculative{false};
+    // the generator itself is part of m_State, reset() restarts it from
+    // these
+    uint64_t m_RandomSeed;
+    uint64_t m_RandomStream;
+    // of the bytes the last loadRom() put into memory
+    uint64_t m_RomHash;
+    // memory as of the last fork() or loadFork(), except for the pages with
+    // their bit set in m_DirtyPages
+    std::array<std::shared_ptr<const Chip8Fork::Page>, Chip8Fork::PAGE_CNT> m_Pages;
+    uint16_t m_DirtyPages;
+    // stateHash() is the sum of the hashes of every memory block and screen
+    // row, only the ones with their dirty bit set are hashed again
+    std::array<uint64_t, HASH_BLOCK_CNT> m_BlockHashes{};
+    std::array<uint64_t, GFX_ROWS> m_RowHashes{};
+    uint64_t m_MemoryHash{0};
+    uint64_t m_GfxHash{0};
+    uint64_t m_DirtyBlocks;
+    uint32_t m_DirtyRows;
+#ifdef PROFILER_PACKAGE
+    Chip8Profiler m_Profiler;
+#endif
     
 };
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "Chip8Coverage.hxx"
+
+Chip8Coverage::Chip8Coverage()
+{
+    reset();
+}
+
+void Chip8Coverage::reset(void)
+{
+    m_ExecCnt.fill(0);
+    m_ReadCnt.fill(0);
+    m_WriteCnt.fill(0);
+}
+
+bool Chip8Coverage::isSelfModified(uint16_t addr) const
+{
+    return (m_ExecCnt[addr & 0xFFF] > 0) and (m_WriteCnt[addr & 0xFFF] > 0);
+}
+
+void Chip8Coverage::save(const std::string& basePath) const
+{
+    constexpr std::size_t SIDE = 64;
+    constexpr std::size_t WIDTH = 3*SIDE + 2;
+    const std::array<const std::array<uint64_t, MEMORY_SIZE_B>*, 3> panels = {&m_ExecCnt, &m_ReadCnt, &m_WriteCnt};
+
+    // log scaling keeps rarely touched bytes visible next to hot loops,
+    // a one pixel gray column separates the panels
+    std::vector<uint8_t> pixels(WIDTH*SIDE, 0x40);
+    for (std::size_t panel = 0; panel < panels.size(); panel++)
+    {
+        const auto& cnt = *panels[panel];
+        double maxLog = std::log1p(static_cast<double>(*std::max_element(cnt.begin(), cnt.end())));
+        for (std::size_t addr = 0; addr < MEMORY_SIZE_B; addr++)
+        {
+            double level = (0.0 == maxLog) ? 0.0 : std::log1p(static_cast<double>(cnt[addr]))/maxLog;
+            pixels[(addr/SIDE)*WIDTH + panel*(SIDE + 1) + addr%SIDE] = static_cast<uint8_t>(std::lround(255.0*level));
+        }
+    }
+    std::ofstream pgm(basePath + ".pgm", std::ios::out | std::ios::binary);
+    pgm << fmt::format("P5\n{} {}\n255\n", WIDTH, SIDE);
+    pgm.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+
+    std::ofstream csv(basePath + ".csv");
+    csv << "addr,exec,read,write,self_modified\n";
+    for (uint16_t addr = 0; addr < MEMORY_SIZE_B; addr++)
+    {
+        if ((0 == m_ExecCnt[addr]) and (0 == m_ReadCnt[addr]) and (0 == m_WriteCnt[addr]))
+        {
+            continue;
+        }
+        csv << fmt::format("0x{:03X},{},{},{},{}\n", addr, m_ExecCnt[addr], m_ReadCnt[addr], 
+                m_WriteCnt[addr], isSelfModified(addr) ? 1 : 0);
+    }
+    if (not pgm.good() or not csv.good())
+    {
+        throw std::runtime_error(fmt::format("Unable to write {}.pgm and {}.csv", basePath, basePath));
+    }
+}
+
+void Chip8NoCoverage::save([[maybe_unused]] const std::string& basePath) const
+{
+    throw std::runtime_error("Coverage is not compiled in, configure with -DBUILD_COVERAGE_PACKAGE=ON");
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <string>
+
+// Memory access policies for Chip8, picked at compile time. Chip8Coverage
+// counts how often every byte is executed, read as data (DRW, Fx65) and
+// written (Fx33, Fx55); Chip8NoCoverage has the same interface and compiles
+// to nothing. -DBUILD_COVERAGE_PACKAGE=ON selects Chip8Coverage.
+class Chip8Coverage
+{
+    public:
+        static constexpr bool IS_ENABLED = true;
+        static constexpr std::size_t MEMORY_SIZE_B = 4096;
+
+        Chip8Coverage();
+        void reset(void);
+
+        inline void execute(uint16_t pc)
+        {
+            m_ExecCnt[pc & 0xFFF]++;
+            m_ExecCnt[(pc + 1) & 0xFFF]++;
+        }
+
+        inline void read(uint16_t addr, uint16_t len)
+        {
+            for (uint16_t i = 0; i < len; i++)
+            {
+                m_ReadCnt[(addr + i) & 0xFFF]++;
+            }
+        }
+
+        inline void write(uint16_t addr, uint16_t len)
+        {
+            for (uint16_t i = 0; i < len; i++)
+            {
+                m_WriteCnt[(addr + i) & 0xFFF]++;
+            }
+        }
+
+        // Bytes that were both written and executed, i.e. self-modifying code
+        bool isSelfModified(uint16_t addr) const;
+        // <basePath>.pgm: execute, read and write heatmaps side by side, one
+        // 64x64 panel each, log scaled
+        // <basePath>.csv: counters of every accessed byte
+        void save(const std::string& basePath) const;
+
+    private:
+        std::array<uint64_t, MEMORY_SIZE_B> m_ExecCnt;
+        std::array<uint64_t, MEMORY_SIZE_B> m_ReadCnt;
+        std::array<uint64_t, MEMORY_SIZE_B> m_WriteCnt;
+};
+
+class Chip8NoCoverage
+{
+    public:
+        static constexpr bool IS_ENABLED = false;
+
+        inline void reset(void) {}
+        inline void execute(uint16_t) {}
+        inline void read(uint16_t, uint16_t) {}
+        inline void write(uint16_t, uint16_t) {}
+        void save(const std::string& basePath) const;
+};
+
+#ifdef COVERAGE_PACKAGE
+typedef Chip8Coverage Chip8CoveragePolicy;
+#else
+typedef Chip8NoCoverage Chip8CoveragePolicy;
+#endif
@@ -0,0 +1,120 @@
+#include <array>
+
+#include <fmt/core.h>
+
+#include "Chip8Disassembler.hxx"
+
+namespace
+{
+    typedef struct
+    {
+        uint16_t mask;
+        uint16_t value;
+        const char* pattern;
+        const char* mnemonic;
+        bool isControlFlow;
+    } OpInfo;
+
+    // Same names as the instruction comments in Chip8.cxx. Order matters,
+    // the first match wins and the last entry catches everything else.
+    const std::array<OpInfo, Chip8Disassembler::OP_CLASS_CNT> OP_INFO = 
+    {{
+        {0xFFFF, 0x00E0, "00E0", "CLS",              false},
+        {0xFFFF, 0x00EE, "00EE", "RET",              true },
+        {0xF000, 0x0000, "0nnn", "SYS addr",         false},
+        {0xF000, 0x1000, "1nnn", "JP addr",          true },
+        {0xF000, 0x2000, "2nnn", "CALL addr",        true },
+        {0xF000, 0x3000, "3xkk", "SE Vx, byte",      true },
+        {0xF000, 0x4000, "4xkk", "SNE Vx, byte",     true },
+        {0xF00F, 0x5000, "5xy0", "SE Vx, Vy",        true },
+        {0xF000, 0x6000, "6xkk", "LD Vx, byte",      false},
+        {0xF000, 0x7000, "7xkk", "ADD Vx, byte",     false},
+        {0xF00F, 0x8000, "8xy0", "LD Vx, Vy",        false},
+        {0xF00F, 0x8001, "8xy1", "OR Vx, Vy",        false},
+        {0xF00F, 0x8002, "8xy2", "AND Vx, Vy",       false},
+        {0xF00F, 0x8003, "8xy3", "XOR Vx, Vy",       false},
+        {0xF00F, 0x8004, "8xy4", "ADD Vx, Vy",       false},
+        {0xF00F, 0x8005, "8xy5", "SUB Vx, Vy",       false},
+        {0xF00F, 0x8006, "8xy6", "SHR Vx {, Vy}",    false},
+        {0xF00F, 0x8007, "8xy7", "SUBN Vx, Vy",      false},
+        {0xF00F, 0x800E, "8xyE", "SHL Vx {, Vy}",    false},
+        {0xF00F, 0x9000, "9xy0", "SNE Vx, Vy",       true },
+        {0xF000, 0xA000, "Annn", "LD I, addr",       false},
+        {0xF000, 0xB000, "Bnnn", "JP V0, addr",      true },
+        {0xF000, 0xC000, "Cxkk", "RND Vx, byte",     false},
+        {0xF000, 0xD000, "Dxyn", "DRW Vx, Vy, nibble", false},
+        {0xF0FF, 0xE09E, "Ex9E", "SKP Vx",           true },
+        {0xF0FF, 0xE0A1, "ExA1", "SKNP Vx",          true },
+        {0xF0FF, 0xF007, "Fx07", "LD Vx, DT",        false},
+        {0xF0FF, 0xF00A, "Fx0A", "LD Vx, K",         true },
+        {0xF0FF, 0xF015, "Fx15", "LD DT, Vx",        false},
+        {0xF0FF, 0xF018, "Fx18", "LD ST, Vx",        false},
+        {0xF0FF, 0xF01E, "Fx1E", "ADD I, Vx",        false},
+        {0xF0FF, 0xF029, "Fx29", "LD F, Vx",         false},
+        {0xF0FF, 0xF033, "Fx33", "LD B, Vx",         false},
+        {0xF0FF, 0xF055, "Fx55", "LD [I], Vx",       false},
+        {0xF0FF, 0xF065, "Fx65", "LD Vx, [I]",       false},
+        {0x0000, 0x0000, "????", "unknown",          false},
+    }};
+
+    // 0nnn is only a valid class when it is not 00E0/00EE, the table order
+    // takes care of that
+    const OpInfo& lookup(uint16_t op)
+    {
+        return OP_INFO[Chip8Disassembler::opClassId(op)];
+    }
+
+    void replaceAll(std::string& s, const std::string& from, const std::string& to)
+    {
+        for (auto pos = s.find(from); std::string::npos != pos; pos = s.find(from, pos + to.size()))
+        {
+            s.replace(pos, from.size(), to);
+        }
+    }
+}
+
+uint8_t Chip8Disassembler::opClassId(uint16_t op)
+{
+    for (uint8_t id = 0; id < OP_CLASS_CNT; id++)
+    {
+        if ((op & OP_INFO[id].mask) == OP_INFO[id].value)
+        {
+            return id;
+        }
+    }
+    return OP_CLASS_CNT - 1;
+}
+
+std::string Chip8Disassembler::opClassName(uint8_t id)
+{
+    const auto& info = OP_INFO[(id < OP_CLASS_CNT) ? id : OP_CLASS_CNT - 1];
+    return fmt::format("{} {}", info.pattern, info.mnemonic);
+}
+
+std::string Chip8Disassembler::opClass(uint16_t op)
+{
+    return opClassName(opClassId(op));
+}
+
+std::string Chip8Disassembler::disassemble(uint16_t op)
+{
+    const auto& info = lookup(op);
+    if (0x0000 == info.mask)
+    {
+        return fmt::format("DW 0x{:04X}", op);
+    }
+
+    std::string result = info.mnemonic;
+    replaceAll(result, "{, Vy}", "");
+    replaceAll(result, "Vx", fmt::format("V{:X}", (op & 0x0F00) >> 8));
+    replaceAll(result, "Vy", fmt::format("V{:X}", (op & 0x00F0) >> 4));
+    replaceAll(result, "byte", fmt::format("0x{:02X}", op & 0x00FF));
+    replaceAll(result, "addr", fmt::format("0x{:03X}", op & 0x0FFF));
+    replaceAll(result, "nibble", fmt::format("{}", op & 0x000F));
+    return result;
+}
+
+bool Chip8Disassembler::isControlFlow(uint16_t op)
+{
+    return lookup(op).isControlFlow;
+}
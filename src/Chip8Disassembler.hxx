@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// Opcode decoding for reports and trace tools, not used by the interpreter
+class Chip8Disassembler
+{
+    public:
+        // e.g. 0x8124 -> "ADD V1, V2", unknown opcodes -> "DW 0x8128"
+        static std::string disassemble(uint16_t op);
+        // e.g. 0x8124 -> "8xy4 ADD Vx, Vy", unknown opcodes -> "???? unknown"
+        static std::string opClass(uint16_t op);
+        // Index of the opcode class in [0, OP_CLASS_CNT), cheap enough for per
+        // instruction bookkeeping. Unknown opcodes map to OP_CLASS_CNT - 1.
+        static uint8_t opClassId(uint16_t op);
+        static std::string opClassName(uint8_t id);
+        // jumps, calls, returns, skips and Fx0A end a basic block
+        static bool isControlFlow(uint16_t op);
+
+        static constexpr uint8_t OP_CLASS_CNT = 36;
+};
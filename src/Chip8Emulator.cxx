@@ -3,6 +3,8 @@
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <fstream>
+#include <algorithm>
 
 #include <SDL.h>
 #include <fmt/core.h>
@@ -10,27 +12,54 @@
 #include <spdlog/spdlog.h>
 
 #include "Chip8Emulator.hxx"
+#include "InputScript.hxx"
+#include "Chip8Probes.hxx"
+#include "Chip8SaveState.hxx"
 
 using namespace std::chrono_literals;
 
 void Chip8Emulator::loadRom(const std::string& romPath)
 {
     cpu->loadRom(romPath);
+    m_RomPath = romPath;
 }
 
-Chip8Emulator::Chip8Emulator(unsigned clkHz, unsigned cycleSleep_ms) : 
+Chip8Emulator::Chip8Emulator(unsigned clkHz, unsigned cycleSleep_ms, 
+        const std::string& videoDriver, bool isSoftwareRenderer) : 
     m_ClkHz{clkHz},
     m_CycleSleep_ms{cycleSleep_ms},
+    m_StateSlot{0},
+    m_IsRewinding{false},
+    m_FrameCycles{0},
+    m_IsFrameDone{false},
+    m_RunAheadFrames{0},
+    m_RunAheadStats{},
+    m_MovieKeys{0},
+    m_EmulateTimeline{nullptr},
+    m_FrameTimeline{nullptr},
+    m_FrameStart_ns{0},
     m_LoggerName{fmt::format("{}-Chip8Emulator", getpid())}, 
     m_Logger{spdlog::stdout_color_mt(m_LoggerName)},
-    m_Window{nullptr, SDL_DestroyWindow}
+    m_Window{nullptr, SDL_DestroyWindow},
+    m_ScreenTexture{nullptr, SDL_DestroyTexture},
+    m_OverlayStats{}
 {
     m_Logger->set_level(spdlog::level::trace);
 
     cpu = std::make_unique<Chip8>(m_Logger);
 
+    // Headless boxes have no audio or input devices, so with an explicit
+    // video driver only bring up video
+    Uint32 sdlSubsystems = SDL_INIT_EVERYTHING;
+    if (not videoDriver.empty())
+    {
+        SPDLOG_LOGGER_TRACE(m_Logger, "Using {} video driver", videoDriver);
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, videoDriver.c_str());
+        sdlSubsystems = SDL_INIT_VIDEO;
+    }
+
     SPDLOG_LOGGER_TRACE(m_Logger, "Initializing SDL");
-    if (0 != SDL_Init(SDL_INIT_EVERYTHING))
+    if (0 != SDL_Init(sdlSubsystems))
     {
         std::string err = fmt::format("Unable to initialize SDL: {}", SDL_GetError());
         SPDLOG_LOGGER_ERROR(m_Logger, err);
@@ -56,7 +85,8 @@ Chip8Emulator::Chip8Emulator(unsigned clkHz, unsigned cycleSleep_ms) :
 
     SPDLOG_LOGGER_TRACE(m_Logger, "Creating a renderer");
     m_Renderer.reset(
-            SDL_CreateRenderer(m_Window.get(), -1, SDL_RENDERER_ACCELERATED),
+            SDL_CreateRenderer(m_Window.get(), -1, 
+                isSoftwareRenderer ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED),
             SDL_RendererDeleter()
             );
     if (nullptr == m_Renderer)
@@ -84,6 +114,19 @@ Chip8Emulator::Chip8Emulator(unsigned clkHz, unsigned cycleSleep_ms) :
             static_cast<uint32_t>(windowHeight/Chip8::GFX_ROWS),
             FOREGROUND_COLOR
             );
+
+    SPDLOG_LOGGER_TRACE(m_Logger, "Creating the screen texture");
+    m_ScreenTexture.reset(SDL_CreateTexture(
+                m_Renderer.get(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                windowWidth, windowHeight));
+    if (nullptr == m_ScreenTexture)
+    {
+        std::string err = fmt::format("Unable to create the screen texture: {}", SDL_GetError());
+        SPDLOG_LOGGER_ERROR(m_Logger, err);
+        throw std::runtime_error(err);
+    }
+    SDL_SetRenderTarget(m_Renderer.get(), m_ScreenTexture.get());
+    m_Overlay = std::make_unique<Chip8Overlay>(m_Renderer);
 }
 
 Chip8Emulator::~Chip8Emulator() 
@@ -92,6 +135,118 @@ Chip8Emulator::~Chip8Emulator()
 }
 
 void Chip8Emulator::drawGfx(void)
+{
+    Timeline::Scope drawScope(m_EmulateTimeline, "draw_gfx");
+    {
+        Timeline::Scope renderScope(m_EmulateTimeline, "render_gfx");
+        renderGfx();
+    }
+
+    // Update screen
+    Timeline::Scope presentScope(m_EmulateTimeline, "present");
+    presentFrame();
+    afterPresent();
+}
+
+// Bookkeeping of every frame that reached the window
+void Chip8Emulator::afterPresent(void)
+{
+    CHIP8_PROBE(frame_present);
+    if (m_InputLatency)
+    {
+        m_InputLatency->onPresent();
+    }
+    if (m_EmulatorMetrics)
+    {
+        m_EmulatorMetrics->onPresent();
+    }
+    if (m_Overlay->isVisible())
+    {
+        auto now = std::chrono::steady_clock::now();
+        double frameTime_ms = std::chrono::duration<double, std::milli>(now - m_OverlayStats.lastFrame).count();
+        if (std::chrono::steady_clock::time_point{} != m_OverlayStats.lastFrame)
+        {
+            m_OverlayStats.frames++;
+            m_OverlayStats.frameTimeSum_ms += frameTime_ms;
+            m_OverlayStats.frameTimeSquareSum_ms += frameTime_ms*frameTime_ms;
+        }
+        m_OverlayStats.lastFrame = now;
+    }
+}
+
+// Draws the whole screen from scratch, for when it changed without a DRW
+void Chip8Emulator::redrawGfx(void)
+{
+    clearScreen();
+    const auto& gfx = cpu->getGfx();
+    for (int row = 0; row < Chip8::GFX_ROWS; row++)
+    {
+        for (int col = 0; col < Chip8::GFX_COLS; col++)
+        {
+            if (gfx(static_cast<std::size_t>(row), static_cast<std::size_t>(col)))
+            {
+                m_ForegroundBlock->render(col*m_ForegroundBlock->getWidth(), row*m_ForegroundBlock->getHeight());
+            }
+        }
+    }
+    presentFrame();
+}
+
+// The screen texture and the overlay on top of it go to the window, drawing
+// continues into the screen texture afterwards
+void Chip8Emulator::presentFrame(void)
+{
+    SDL_SetRenderTarget(m_Renderer.get(), nullptr);
+    SDL_RenderCopy(m_Renderer.get(), m_ScreenTexture.get(), nullptr, nullptr);
+    m_Overlay->composite();
+    SDL_RenderPresent(m_Renderer.get());
+    SDL_SetRenderTarget(m_Renderer.get(), m_ScreenTexture.get());
+}
+
+void Chip8Emulator::toggleOverlay(void)
+{
+    m_Overlay->toggle();
+    m_OverlayStats = {};
+    m_OverlayStats.windowStart = std::chrono::steady_clock::now();
+    presentFrame();
+}
+
+// Redraws the overlay with the numbers of the last window, called once per
+// emulation batch
+void Chip8Emulator::updateOverlay(uint64_t cycles)
+{
+    m_OverlayStats.cycles += cycles;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> window = now - m_OverlayStats.windowStart;
+    if (window < OVERLAY_UPDATE_PERIOD_mS)
+    {
+        return;
+    }
+
+    double frames = static_cast<double>(m_OverlayStats.frames);
+    double frameTime_ms = 0.0;
+    double jitter_ms = 0.0;
+    if (m_OverlayStats.frames > 0)
+    {
+        frameTime_ms = m_OverlayStats.frameTimeSum_ms/frames;
+        jitter_ms = std::sqrt(std::max(0.0, m_OverlayStats.frameTimeSquareSum_ms/frames - frameTime_ms*frameTime_ms));
+    }
+    m_Overlay->update(
+            static_cast<double>(m_OverlayStats.cycles)/window.count()/1e6,
+            frames/window.count(),
+            frameTime_ms,
+            jitter_ms);
+    presentFrame();
+
+    m_OverlayStats.windowStart = now;
+    m_OverlayStats.cycles = 0;
+    m_OverlayStats.frames = 0;
+    m_OverlayStats.frameTimeSum_ms = 0.0;
+    m_OverlayStats.frameTimeSquareSum_ms = 0.0;
+}
+
+// Renders pixels changed by the last DRW, returns the number of blocks drawn
+std::size_t Chip8Emulator::renderGfx(void)
 {
     const auto& updatedPixels = cpu->getUpdatedPixelsState();
     for (const auto& pixel : updatedPixels)
@@ -104,12 +259,56 @@ void Chip8Emulator::drawGfx(void)
         p_B->render(pixel.col*p_B->getWidth(), pixel.row*p_B->getHeight());
     }
 
-    // Update screen
-    SDL_RenderPresent(m_Renderer.get());
+    return updatedPixels.size();
 }
 
 void Chip8Emulator::handleKeyboard(const SDL_Event &e)
 {
+    if (SDLK_F1 == e.key.keysym.sym)
+    {
+        if ((SDL_KEYDOWN == e.type) and (0 == e.key.repeat))
+        {
+            toggleOverlay();
+        }
+        return;
+    }
+
+    // Backspace rewinds while it is held
+    if (SDLK_BACKSPACE == e.key.keysym.sym)
+    {
+        m_IsRewinding = m_Rewind and (SDL_KEYDOWN == e.type);
+        return;
+    }
+
+    // F5 saves the state slot, F9 loads it. A missing or mismatched slot
+    // must not end the session.
+    if ((SDLK_F5 == e.key.keysym.sym) or (SDLK_F9 == e.key.keysym.sym))
+    {
+        if ((SDL_KEYDOWN == e.type) and (0 == e.key.repeat))
+        {
+            try
+            {
+                if (SDLK_F5 == e.key.keysym.sym)
+                {
+                    saveStateSlot();
+                }
+                else if (m_Movie)
+                {
+                    throw std::runtime_error("States can not be loaded while recording a movie");
+                }
+                else
+                {
+                    loadStateSlot();
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                m_Logger->error("{}", ex.what());
+            }
+        }
+        return;
+    }
+
     // 1 2 3 4        1 2 3 C
     // Q W E R  --->  4 5 6 D
     // A S D F        7 8 9 E
@@ -136,8 +335,29 @@ void Chip8Emulator::handleKeyboard(const SDL_Event &e)
 
     SPDLOG_LOGGER_TRACE(m_Logger, "Pressed {} key", pressedKey);
 
-    cpu->setKey(pressedKey, (e.type == SDL_KEYDOWN) ? 
-            Chip8::KEY_PRESSED_VALUE : Chip8::KEY_NOT_PRESSED_VALUE);
+    if (m_Movie)
+    {
+        // latched until the next frame starts, so the movie holds exactly
+        // what the core saw
+        uint16_t bit = static_cast<uint16_t>(1U << pressedKey);
+        m_MovieKeys = static_cast<uint16_t>((SDL_KEYDOWN == e.type) ? (m_MovieKeys | bit) : (m_MovieKeys & ~bit));
+    }
+    else
+    {
+        cpu->setKey(pressedKey, (e.type == SDL_KEYDOWN) ? 
+                Chip8::KEY_PRESSED_VALUE : Chip8::KEY_NOT_PRESSED_VALUE);
+    }
+    if (m_EmulatorMetrics and (SDL_KEYDOWN == e.type))
+    {
+        m_EmulatorMetrics->onKeyDown();
+    }
+    if (m_InputLatency and (SDL_KEYDOWN == e.type) and (0 == e.key.repeat))
+    {
+        // the event may have waited in SDL's queue through the whole sleep,
+        // its millisecond timestamp says when it arrived
+        auto queued = std::chrono::milliseconds(SDL_GetTicks() - e.key.timestamp);
+        m_InputLatency->onKeyDown(*cpu, pressedKey, InputLatency::clock::now() - queued);
+    }
 }
 
 void Chip8Emulator::clearScreen(void)
@@ -153,57 +373,135 @@ void Chip8Emulator::clearScreen(void)
 }
 
 
-void Chip8Emulator::runTimers(void)
-{
-    while (true)
-    {
-        cpu->decrementTimers();
-        std::this_thread::sleep_for(Chip8::TIMER_PERIOD_mS);
-    }
-}
-
 void Chip8Emulator::emulate(void)
 {
-    clearScreen();
+    m_EmulateTimeline = m_Timeline ? m_Timeline->addThread("emulate") : nullptr;
+    m_FrameTimeline = m_Timeline ? m_Timeline->addThread("emulate_frames") : nullptr;
+    m_FrameStart_ns = Timeline::now();
+    // a resumed state already has pixels on
+    redrawGfx();
 
     SDL_Event e;
     
     auto prevTime = std::chrono::high_resolution_clock::now();
     while(true)
     {
+        Timeline::Scope batchScope(m_EmulateTimeline, "batch");
         auto currTime = std::chrono::high_resolution_clock::now();
         auto delta = std::chrono::duration<float>(currTime - prevTime);
         auto instructionCount = std::lroundf(delta.count()*static_cast<float>(m_ClkHz));
         prevTime = currTime;
         SPDLOG_LOGGER_TRACE(m_Logger, fmt::format("Instruction count: {}", instructionCount));
+        CHIP8_PROBE1(batch_start, instructionCount);
         for(decltype(instructionCount) cnt = 0; cnt < instructionCount; cnt++)
         {
-            while (0 != SDL_PollEvent(&e))
             {
-                switch (e.type)
+                Timeline::Scope pollScope(m_EmulateTimeline, "poll_events");
+                while (0 != SDL_PollEvent(&e))
                 {
-                    case SDL_QUIT:
-                        goto Chip8Emulator_run_exit;
-                        break;
-
-                    case SDL_KEYDOWN:
-                    case SDL_KEYUP:
-                        handleKeyboard(e);
-                        break;
-
-                    default:
-                        break;
+                    switch (e.type)
+                    {
+                        case SDL_QUIT:
+                            goto Chip8Emulator_run_exit;
+                            break;
+
+                        case SDL_KEYDOWN:
+                        case SDL_KEYUP:
+                            handleKeyboard(e);
+                            break;
+
+                        default:
+                            break;
+                    }
                 }
             }
+            if (m_IsRewinding)
+            {
+                break;
+            }
 
-            cpu->emulateCycle();
+            if (m_Movie and (0 == m_FrameCycles))
+            {
+                cpu->setKeys(m_MovieKeys);
+                m_Movie->record(m_MovieKeys);
+            }
+            {
+                Timeline::Scope cycleScope(m_EmulateTimeline, "emulate_cycle");
+                if (m_StackSampler)
+                {
+                    m_StackSampler->tick(*cpu);
+                }
+                if (m_TraceRecorder)
+                {
+                    m_TraceRecorder->emulateCycle(*cpu);
+                }
+                else
+                {
+                    cpu->emulateCycle();
+                }
+            }
+            if (m_EmulatorMetrics)
+            {
+                m_EmulatorMetrics->onCycle(*cpu);
+            }
+            if (m_InputLatency)
+            {
+                m_InputLatency->onCycle(*cpu);
+            }
+            if (++m_FrameCycles >= std::max(1U, m_ClkHz/Chip8::TIMER_HZ))
+            {
+                m_FrameCycles = 0;
+                m_IsFrameDone = true;
+                if (nullptr != m_FrameTimeline)
+                {
+                    auto frameEnd_ns = Timeline::now();
+                    m_FrameTimeline->add("frame", m_FrameStart_ns, frameEnd_ns);
+                    m_FrameStart_ns = frameEnd_ns;
+                }
+                {
+                    // ticked here rather than on the wall clock, so every
+                    // snapshot, fork and movie frame sees whole frames
+                    Timeline::Scope timerScope(m_EmulateTimeline, "decrement_timers");
+                    cpu->decrementTimers();
+                }
+                if (m_Rewind)
+                {
+                    recordRewind();
+                }
+            }
 
-            if (cpu->isDrw())
+            // with run-ahead only the frames from the future are presented
+            if (cpu->isDrw() and (0 == m_RunAheadFrames))
             {
                 drawGfx();
             }
         }
+        CHIP8_PROBE1(batch_end, instructionCount);
+        if ((0 != m_RunAheadFrames) and (not m_IsRewinding))
+        {
+            m_RunAheadStats.emulatedCycles += static_cast<uint64_t>(instructionCount);
+            if (m_IsFrameDone)
+            {
+                Timeline::Scope runAheadScope(m_EmulateTimeline, "run_ahead");
+                runAhead();
+            }
+        }
+        m_IsFrameDone = false;
+        if (m_IsRewinding)
+        {
+            Timeline::Scope rewindScope(m_EmulateTimeline, "rewind");
+            rewind(delta);
+        }
+        if (m_EmulatorMetrics)
+        {
+            m_EmulatorMetrics->onBatch(static_cast<uint64_t>(instructionCount), delta);
+        }
+        if (m_Overlay->isVisible())
+        {
+            updateOverlay(static_cast<uint64_t>(instructionCount));
+        }
 
+        Timeline::Scope sleepScope(m_EmulateTimeline, "sleep");
         std::this_thread::sleep_for(std::chrono::milliseconds(m_CycleSleep_ms));
     }
 
@@ -216,12 +514,462 @@ Chip8Emulator_run_exit:;
 
 void Chip8Emulator::run(void)
 {
+    auto start = std::chrono::steady_clock::now();
     auto emulationThread = std::thread(&Chip8Emulator::emulate, this);
-    auto timerThread = std::thread(&Chip8Emulator::runTimers, this);
-
-    timerThread.detach();
     emulationThread.join();
-    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    writeProfileReport();
+    writeCoverage();
+    writeFoldedStacks();
+    writeTimeline();
+    writeInputLatency();
+    writeMovie();
+    if (m_Rewind)
+    {
+        const auto& stats = m_Rewind->getStats();
+        double frames = static_cast<double>(std::max<uint64_t>(1, stats.frames));
+        m_Logger->info("Rewind recorded {} frames, {:.1f} bytes and {:.3f} us per frame, {} frames held in {} bytes",
+                stats.frames, static_cast<double>(stats.bytes)/frames, 1e6*stats.recordTime.count()/frames,
+                m_Rewind->getDepth() + 1, m_Rewind->getUsedBytes());
+    }
+    if (0 != m_RunAheadFrames)
+    {
+        double runs = static_cast<double>(std::max<uint64_t>(1, m_RunAheadStats.runs));
+        double emulated = static_cast<double>(std::max<uint64_t>(1, m_RunAheadStats.emulatedCycles));
+        m_Logger->info("Run-ahead of {} frames ran {} times, {:.1f} us per run, {:.2f} extra cycles per "
+                "emulated cycle, {:.2f}% of the run time",
+                m_RunAheadFrames, m_RunAheadStats.runs, 1e6*m_RunAheadStats.time.count()/runs,
+                static_cast<double>(m_RunAheadStats.cycles)/emulated,
+                100.0*m_RunAheadStats.time.count()/elapsed.count());
+    }
+    if (m_MetricsExporter)
+    {
+        m_MetricsExporter->flush();
+    }
+}
+
+void Chip8Emulator::setProfileReportPath(const std::string& path)
+{
+    m_ProfileReportPath = path;
+}
+
+// Does nothing unless a report path was set
+void Chip8Emulator::writeProfileReport(void) const
+{
+    if (m_ProfileReportPath.empty())
+    {
+        return;
+    }
+    std::ofstream report(m_ProfileReportPath);
+    cpu->writeProfileReport(report);
+}
+
+void Chip8Emulator::setCoveragePath(const std::string& basePath)
+{
+    m_CoveragePath = basePath;
+}
+
+// Does nothing unless a coverage path was set
+void Chip8Emulator::writeCoverage(void) const
+{
+    if (m_CoveragePath.empty())
+    {
+        return;
+    }
+    cpu->writeCoverage(m_CoveragePath);
+}
+
+// An empty path disables call stack sampling
+void Chip8Emulator::setFoldedStacksPath(const std::string& path, unsigned samplePeriodCycles)
+{
+    m_FoldedStacksPath = path;
+    m_StackSampler.reset();
+    if (not path.empty())
+    {
+        m_StackSampler = std::make_unique<Chip8StackSampler>(samplePeriodCycles);
+    }
+}
+
+// On a ROM fault the machine state and the last instructions go to path
+void Chip8Emulator::setCrashDumpPath(const std::string& path)
+{
+    cpu->setCrashDumpPath(path);
+}
+
+// Records every cycle of run(), keeping the last `capacity` ones
+void Chip8Emulator::enableTrace(const std::string& tracePath, uint32_t capacity)
+{
+    m_TraceRecorder = std::make_unique<Chip8TraceRecorder>(tracePath, capacity);
+}
+
+void Chip8Emulator::writeFoldedStacks(void) const
+{
+    if (not m_StackSampler)
+    {
+        return;
+    }
+    std::ofstream folded(m_FoldedStacksPath);
+    m_StackSampler->writeFolded(folded);
+}
+
+// An empty path disables the timeline. Threads started after this record
+// into it.
+void Chip8Emulator::setTimelinePath(const std::string& path)
+{
+    m_TimelinePath = path;
+    m_Timeline.reset();
+    if (not path.empty())
+    {
+        m_Timeline = std::make_unique<Timeline>();
+    }
+}
+
+void Chip8Emulator::writeTimeline(void) const
+{
+    if (not m_Timeline)
+    {
+        return;
+    }
+    std::ofstream timeline(m_TimelinePath);
+    m_Timeline->write(timeline);
+}
+
+// target is a file, rewritten every period_ms, or unix:<socket path>
+void Chip8Emulator::enableMetrics(const std::string& target, unsigned period_ms)
+{
+    m_MetricsExporter.reset();
+    m_Metrics = std::make_unique<Metrics>();
+    m_EmulatorMetrics = std::make_unique<EmulatorMetrics>(*m_Metrics, m_ClkHz);
+    m_MetricsExporter = std::make_unique<MetricsExporter>(
+            *m_Metrics, target, std::chrono::milliseconds(period_ms));
+}
+
+// An empty path disables following key presses to the screen
+void Chip8Emulator::setInputLatencyPath(const std::string& path)
+{
+    m_InputLatencyPath = path;
+    m_InputLatency.reset();
+    if (not path.empty())
+    {
+        m_InputLatency = std::make_unique<InputLatency>(std::max(1U, m_ClkHz/Chip8::TIMER_HZ));
+    }
+}
+
+void Chip8Emulator::writeInputLatency(void) const
+{
+    if (not m_InputLatency)
+    {
+        return;
+    }
+    std::ofstream latency(m_InputLatencyPath);
+    m_InputLatency->write(latency);
+}
+
+// Every emulated 60Hz frame is recorded from now on, a budget of 0 turns
+// rewinding off
+void Chip8Emulator::enableRewind(std::size_t budget_B)
+{
+    m_Rewind.reset();
+    if (0 != budget_B)
+    {
+        m_Rewind = std::make_unique<Chip8Rewind>(budget_B);
+    }
+}
+
+// Called at the end of every 60Hz frame
+void Chip8Emulator::recordRewind(void)
+{
+    Chip8State state;
+    cpu->saveState(state);
+    m_Rewind->record(state);
+}
+
+// Steps back REWIND_FPS frames per second of wall time, instead of emulating
+void Chip8Emulator::rewind(std::chrono::duration<float> elapsed)
+{
+    auto frames = static_cast<unsigned>(std::max(1L, std::lroundf(elapsed.count()*REWIND_FPS)));
+    Chip8State state;
+    if (0 == m_Rewind->rewind(frames, state))
+    {
+        return;
+    }
+    cpu->loadState(state);
+    m_FrameCycles = 0;
+    if (m_Movie)
+    {
+        // the rewound frames are taken back, recording goes on from there
+        m_Movie->truncate(state.cycleCnt/std::max(1U, m_ClkHz/Chip8::TIMER_HZ));
+    }
+    redrawGfx();
+}
+
+// Has to be called after loadRom(), the ROM has to run from reset
+void Chip8Emulator::recordMovie(const std::string& path)
+{
+    m_MoviePath = path;
+    m_Movie = std::make_unique<Chip8Movie>(cpu->getRomHash(), cpu->getRandomSeed(),
+            cpu->getRandomStream(), m_ClkHz);
+    m_MovieKeys = 0;
+}
+
+// The frame the session was quit in is finished first, replays run whole
+// frames
+void Chip8Emulator::writeMovie(void)
+{
+    if (not m_Movie)
+    {
+        return;
+    }
+    if (0 != m_FrameCycles)
+    {
+        for (; m_FrameCycles < std::max(1U, m_ClkHz/Chip8::TIMER_HZ); m_FrameCycles++)
+        {
+            cpu->emulateCycle();
+        }
+        cpu->decrementTimers();
+        m_FrameCycles = 0;
+    }
+    m_Movie->setFinalStateHash(cpu->stateHash());
+    m_Movie->save(m_MoviePath);
+    m_Logger->info("Recorded {} frames to {}, final state hash 0x{:016X}",
+            m_Movie->getFrameCount(), m_MoviePath, m_Movie->getFinalStateHash());
+}
+
+void Chip8Emulator::setRunAhead(unsigned frames)
+{
+    m_RunAheadFrames = frames;
+}
+
+// Once per batch that ended a frame: forks the machine, emulates
+// m_RunAheadFrames frames with the keys held now, presents the screen that
+// results and goes back to the fork. A ROM that reacts to a key a few frames
+// after reading it is seen reacting that many frames earlier. The
+// speculative cycles skip the trace, stack sampler and metrics, and the core
+// keeps them out of crash dumps, coverage, the profiler and the probes. They
+// count for input latency, which measures what is seen. Their timer ticks
+// are undone with the rest, the real ones happen in emulate().
+void Chip8Emulator::runAhead(void)
+{
+    auto start = std::chrono::steady_clock::now();
+    const unsigned cyclesPerFrame = std::max(1U, m_ClkHz/Chip8::TIMER_HZ);
+    cpu->fork(m_RunAheadFork);
+    cpu->setSpeculative(true);
+    try
+    {
+        for (unsigned frame = 0; frame < m_RunAheadFrames; frame++)
+        {
+            for (unsigned cycle = 0; cycle < cyclesPerFrame; cycle++)
+            {
+                cpu->emulateCycle();
+                if (m_InputLatency)
+                {
+                    m_InputLatency->onCycle(*cpu);
+                }
+            }
+            cpu->decrementTimers();
+        }
+        m_RunAheadStats.cycles += m_RunAheadFrames*cyclesPerFrame;
+        redrawGfx();
+        afterPresent();
+    }
+    catch (const Chip8Fault&)
+    {
+        // the real run gets to the same fault and reports it
+    }
+    cpu->setSpeculative(false);
+    cpu->loadFork(m_RunAheadFork);
+    m_RunAheadStats.runs++;
+    m_RunAheadStats.time += std::chrono::steady_clock::now() - start;
+}
+
+// Slot n of rom.ch8 is rom.ch8.n.state next to the ROM
+void Chip8Emulator::setStateSlot(unsigned slot)
+{
+    m_StateSlot = slot;
+}
+
+std::string Chip8Emulator::getStateSlotPath(void) const
+{
+    return fmt::format("{}.{}.state", m_RomPath, m_StateSlot);
+}
+
+void Chip8Emulator::saveStateSlot(void) const
+{
+    Chip8SaveState::save(*cpu, getStateSlotPath());
+    m_Logger->info("Saved state to {}", getStateSlotPath());
+}
+
+// Only called between cycles of the emulation thread, which also ticks the
+// timers. The state can be saved mid frame, the frame phase is taken from its
+// cycle count the way the headless runner does.
+void Chip8Emulator::loadStateSlot(void)
+{
+    Chip8SaveState::load(*cpu, getStateSlotPath());
+    m_FrameCycles = static_cast<unsigned>(cpu->getCycleCount()%std::max(1U, m_ClkHz/Chip8::TIMER_HZ));
+    redrawGfx();
+    m_Logger->info("Loaded state from {}", getStateSlotPath());
+}
+
+Chip8Emulator::EmulatorMetrics::EmulatorMetrics(Metrics& metrics, unsigned clkHz) :
+    m_Cycles{metrics.addCounter("chip8_cycles_total", "Instructions executed")},
+    m_EffectiveClockHz{metrics.addGauge("chip8_effective_clock_hz", 
+            "Instructions executed per second of wall time, over the last second")},
+    m_FramesPresented{metrics.addCounter("chip8_frames_presented_total", "Frames presented")},
+    m_FramesDropped{metrics.addCounter("chip8_frames_dropped_total", 
+            "60Hz frames passed between two emulation batches without a chance to present")},
+    m_FrameTime{metrics.addHistogram("chip8_frame_time_seconds", "Time between two presented frames")},
+    m_Drw{metrics.addCounter("chip8_drw_total", "DRW instructions executed")},
+    m_KeyWait{metrics.addHistogram("chip8_key_wait_seconds", "Time spent in Fx0A waiting for a key")},
+    m_InputLatency{metrics.addHistogram("chip8_input_latency_seconds", 
+            "Time from a key press to the next presented frame")},
+    m_WindowStart{clock::now()},
+    m_WindowCycles{0},
+    m_LastPresent{},
+    m_IsKeyWait{false},
+    m_KeyWaitStart{},
+    m_IsInputPending{false},
+    m_InputTime{}
+{
+    metrics.addGauge("chip8_clock_hz", "Configured instructions per second").set(clkHz);
+}
+
+void Chip8Emulator::EmulatorMetrics::onBatch(uint64_t cycles, std::chrono::duration<double> sinceLastBatch)
+{
+    m_Cycles.add(cycles);
+    m_WindowCycles += cycles;
+    auto now = clock::now();
+    std::chrono::duration<double> window = now - m_WindowStart;
+    if (window >= std::chrono::seconds(1))
+    {
+        m_EffectiveClockHz.set(static_cast<double>(m_WindowCycles)/window.count());
+        m_WindowStart = now;
+        m_WindowCycles = 0;
+    }
+
+    auto frames = static_cast<uint64_t>(sinceLastBatch/Chip8::TIMER_PERIOD_mS);
+    if (frames > 1)
+    {
+        m_FramesDropped.add(frames - 1);
+    }
+}
+
+void Chip8Emulator::EmulatorMetrics::onCycle(const Chip8& cpu)
+{
+    if (cpu.isDrw())
+    {
+        m_Drw.add();
+    }
+    if (cpu.isKeyWait() != m_IsKeyWait)
+    {
+        m_IsKeyWait = cpu.isKeyWait();
+        if (m_IsKeyWait)
+        {
+            m_KeyWaitStart = clock::now();
+        }
+        else
+        {
+            m_KeyWait.observe(std::chrono::duration<double>(clock::now() - m_KeyWaitStart).count());
+        }
+    }
+}
+
+// Only the first key press before a frame is presented counts
+void Chip8Emulator::EmulatorMetrics::onKeyDown(void)
+{
+    if (not m_IsInputPending)
+    {
+        m_IsInputPending = true;
+        m_InputTime = clock::now();
+    }
+}
+
+void Chip8Emulator::EmulatorMetrics::onPresent(void)
+{
+    auto now = clock::now();
+    m_FramesPresented.add();
+    if (clock::time_point{} != m_LastPresent)
+    {
+        m_FrameTime.observe(std::chrono::duration<double>(now - m_LastPresent).count());
+    }
+    m_LastPresent = now;
+    if (m_IsInputPending)
+    {
+        m_InputLatency.observe(std::chrono::duration<double>(now - m_InputTime).count());
+        m_IsInputPending = false;
+    }
+}
+
+// Same drawing path as emulate(), without the sleep or the keyboard. A frame
+// is clkHz/60 cycles followed by one timer tick and key presses come from the
+// input script. Wall time is split into emulating, rendering blocks and
+// presenting.
+Chip8Emulator::BenchmarkResult Chip8Emulator::benchmark(uint64_t frames, const std::string& inputScriptPath)
+{
+    using clock = std::chrono::steady_clock;
+
+    InputScript inputScript;
+    if (not inputScriptPath.empty())
+    {
+        inputScript.load(inputScriptPath);
+    }
+
+    BenchmarkResult result{};
+    const unsigned cyclesPerFrame = std::max(1U, m_ClkHz/Chip8::TIMER_HZ);
+
+    m_EmulateTimeline = m_Timeline ? m_Timeline->addThread("benchmark") : nullptr;
+    clearScreen();
+    SDL_Event e;
+
+    auto benchmarkStart = clock::now();
+    for (uint64_t frame = 0; frame < frames; frame++)
+    {
+        Timeline::Scope frameScope(m_EmulateTimeline, "frame");
+        while (0 != SDL_PollEvent(&e))
+        {
+            if (SDL_QUIT == e.type)
+            {
+                goto Chip8Emulator_benchmark_exit;
+            }
+        }
+        inputScript.apply(frame, *cpu);
+
+        auto emulateStart = clock::now();
+        for (unsigned cnt = 0; cnt < cyclesPerFrame; cnt++)
+        {
+            cpu->emulateCycle();
+
+            if (cpu->isDrw())
+            {
+                auto renderStart = clock::now();
+                result.emulate += renderStart - emulateStart;
+
+                {
+                    Timeline::Scope renderScope(m_EmulateTimeline, "render_gfx");
+                    result.drawCalls += renderGfx();
+                }
+                auto presentStart = clock::now();
+                result.render += presentStart - renderStart;
+
+                {
+                    Timeline::Scope presentScope(m_EmulateTimeline, "present");
+                    presentFrame();
+                    CHIP8_PROBE(frame_present);
+                }
+                result.presents++;
+                emulateStart = clock::now();
+                result.present += emulateStart - presentStart;
+            }
+        }
+        cpu->decrementTimers();
+        result.emulate += clock::now() - emulateStart;
+        result.cycles += cyclesPerFrame;
+        result.frames++;
+    }
+
+Chip8Emulator_benchmark_exit:
+    result.total = clock::now() - benchmarkStart;
+    return result;
 }
 
 Chip8Emulator::Block::Block(std::shared_ptr<spdlog::logger> logger, std::shared_ptr<SDL_Renderer> renderer,
@@ -1,9 +1,19 @@
 #pragma once
 #include <memory>
+#include <chrono>
 #include <spdlog/logger.h>
 #include <SDL.h>
 
 #include "Chip8.hxx"
+#include "Chip8StackSampler.hxx"
+#include "Chip8TraceRecorder.hxx"
+#include "Timeline.hxx"
+#include "Metrics.hxx"
+#include "MetricsExporter.hxx"
+#include "Chip8Overlay.hxx"
+#include "InputLatency.hxx"
+#include "Chip8Rewind.hxx"
+#include "Chip8Movie.hxx"
 
 struct SDL_RendererDeleter
 {
@@ -15,18 +25,131 @@ class Chip8Emulator
     public:
         static constexpr unsigned DEFAULT_CLK_HZ = 540;
         static constexpr unsigned DEFAULT_CYCLE_SLEEP_mS = 100;
+        // history frames stepped back per second while the rewind key is held
+        static constexpr unsigned REWIND_FPS = 120;
 
+        typedef struct
+        {
+            uint64_t frames;
+            uint64_t cycles;
+            uint64_t drawCalls;
+            uint64_t presents;
+            std::chrono::duration<double> emulate;
+            std::chrono::duration<double> render;
+            std::chrono::duration<double> present;
+            std::chrono::duration<double> total;
+        } BenchmarkResult;
+
+        // An empty videoDriver lets SDL pick one. Naming one, e.g. "offscreen"
+        // or "dummy", only initializes the SDL video subsystem.
         Chip8Emulator(
                 unsigned clkHz = DEFAULT_CLK_HZ, 
-                unsigned cycleSleep_ms = DEFAULT_CYCLE_SLEEP_mS
+                unsigned cycleSleep_ms = DEFAULT_CYCLE_SLEEP_mS,
+                const std::string& videoDriver = "",
+                bool isSoftwareRenderer = false
                 );
         ~Chip8Emulator();
         void run(void);
+        BenchmarkResult benchmark(uint64_t frames, const std::string& inputScriptPath = "");
         void loadRom(const std::string& romPath);
+        void setProfileReportPath(const std::string& path);
+        void writeProfileReport(void) const;
+        void setCoveragePath(const std::string& basePath);
+        void writeCoverage(void) const;
+        void setFoldedStacksPath(const std::string& path, unsigned samplePeriodCycles);
+        void writeFoldedStacks(void) const;
+        void enableTrace(const std::string& tracePath, uint32_t capacity);
+        void setCrashDumpPath(const std::string& path);
+        void setTimelinePath(const std::string& path);
+        void writeTimeline(void) const;
+        void enableMetrics(const std::string& target, unsigned period_ms);
+        void toggleOverlay(void);
+        void setInputLatencyPath(const std::string& path);
+        void writeInputLatency(void) const;
+        void setStateSlot(unsigned slot);
+        void saveStateSlot(void) const;
+        void loadStateSlot(void);
+        void enableRewind(std::size_t budget_B);
+        void setRunAhead(unsigned frames);
+        void recordMovie(const std::string& path);
+        void writeMovie(void);
 
     private:
         unsigned m_ClkHz;
         unsigned m_CycleSleep_ms;
+        std::string m_RomPath;
+        unsigned m_StateSlot;
+        std::unique_ptr<Chip8Rewind> m_Rewind;
+        bool m_IsRewinding;
+        // cycles emulated since the last 60Hz frame ended
+        unsigned m_FrameCycles;
+        // a frame ended during the current batch
+        bool m_IsFrameDone;
+        // frames emulated ahead of the one presented, 0 disables run-ahead
+        unsigned m_RunAheadFrames;
+        Chip8Fork m_RunAheadFork;
+        typedef struct
+        {
+            uint64_t runs;
+            uint64_t cycles;
+            uint64_t emulatedCycles;
+            std::chrono::duration<double> time;
+        } RunAheadStats;
+        RunAheadStats m_RunAheadStats;
+        std::string m_MoviePath;
+        std::unique_ptr<Chip8Movie> m_Movie;
+        // keys held now, the core sees them from the start of the next frame
+        uint16_t m_MovieKeys;
+        std::string m_ProfileReportPath;
+        std::string m_CoveragePath;
+        std::string m_FoldedStacksPath;
+        std::unique_ptr<Chip8StackSampler> m_StackSampler;
+        std::unique_ptr<Chip8TraceRecorder> m_TraceRecorder;
+        std::string m_TimelinePath;
+        std::unique_ptr<Timeline> m_Timeline;
+        // buffer of the thread that emulates and draws, null when disabled
+        Timeline::Buffer* m_EmulateTimeline;
+        // 60Hz frames span batches and the sleeps between them, so they get a
+        // track of their own instead of nesting in the batches
+        Timeline::Buffer* m_FrameTimeline;
+        uint64_t m_FrameStart_ns;
+
+        // Metrics of the emulation thread and the state needed to derive them,
+        // only that thread updates the state
+        class EmulatorMetrics
+        {
+            public:
+                EmulatorMetrics(Metrics& metrics, unsigned clkHz);
+                void onBatch(uint64_t cycles, std::chrono::duration<double> sinceLastBatch);
+                void onCycle(const Chip8& cpu);
+                void onKeyDown(void);
+                void onPresent(void);
+
+            private:
+                typedef std::chrono::steady_clock clock;
+
+                Metrics::Counter& m_Cycles;
+                Metrics::Gauge& m_EffectiveClockHz;
+                Metrics::Counter& m_FramesPresented;
+                Metrics::Counter& m_FramesDropped;
+                Metrics::Histogram& m_FrameTime;
+                Metrics::Counter& m_Drw;
+                Metrics::Histogram& m_KeyWait;
+                Metrics::Histogram& m_InputLatency;
+
+                clock::time_point m_WindowStart;
+                uint64_t m_WindowCycles;
+                clock::time_point m_LastPresent;
+                bool m_IsKeyWait;
+                clock::time_point m_KeyWaitStart;
+                bool m_IsInputPending;
+                clock::time_point m_InputTime;
+        };
+        std::unique_ptr<Metrics> m_Metrics;
+        std::unique_ptr<EmulatorMetrics> m_EmulatorMetrics;
+        std::unique_ptr<MetricsExporter> m_MetricsExporter;
+        std::string m_InputLatencyPath;
+        std::unique_ptr<InputLatency> m_InputLatency;
                                                                                               //cols, rows
         static constexpr std::pair<uint32_t, uint32_t> SCREEN_SIZE_1280x1024 = std::make_pair(1280, 1024);
         static constexpr SDL_Color BACKGROUND_COLOR = {0, 0, 0, 255}; //Black
@@ -55,12 +178,35 @@ class Chip8Emulator
         std::shared_ptr<spdlog::logger> m_Logger;
         std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)> m_Window;
         std::shared_ptr<SDL_Renderer> m_Renderer;
+        // blocks are drawn here and copied to the window on every present
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_ScreenTexture;
+        std::unique_ptr<Chip8Overlay> m_Overlay;
+
+        static constexpr std::chrono::milliseconds OVERLAY_UPDATE_PERIOD_mS{500};
+        typedef struct
+        {
+            std::chrono::steady_clock::time_point windowStart;
+            std::chrono::steady_clock::time_point lastFrame;
+            uint64_t cycles;
+            uint64_t frames;
+            double frameTimeSum_ms;
+            double frameTimeSquareSum_ms;
+        } OverlayStats;
+        OverlayStats m_OverlayStats;
 
         void drawGfx(void);
+        void redrawGfx(void);
+        std::string getStateSlotPath(void) const;
+        void presentFrame(void);
+        void updateOverlay(uint64_t cycles);
+        void recordRewind(void);
+        void runAhead(void);
+        void afterPresent(void);
+        void rewind(std::chrono::duration<float> elapsed);
+        std::size_t renderGfx(void);
         void clearScreen(void);
         void handleKeyboard(const SDL_Event &e);
         void emulate(void);
-        void runTimers(void);
 
         std::unique_ptr<Block> m_BackgroundBlock;
         std::unique_ptr<Block> m_ForegroundBlock;
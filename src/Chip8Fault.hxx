@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <stdexcept>
+
+// Thrown by Chip8 when the ROM does something the machine can't execute. The
+// address and opcode are those of the faulting instruction.
+class Chip8Fault : public std::runtime_error
+{
+    public:
+        enum class Kind
+        {
+            ILLEGAL_OPCODE,
+            STACK_OVERFLOW,
+            STACK_UNDERFLOW,
+            MEMORY_OUT_OF_BOUNDS,
+        };
+
+        Chip8Fault(Kind kind, uint16_t pc, uint16_t op, const std::string& what) :
+            std::runtime_error(what),
+            m_Kind{kind},
+            m_PC{pc},
+            m_Op{op}
+        {
+        }
+
+        Kind getKind(void) const { return m_Kind; }
+        uint16_t getPC(void) const { return m_PC; }
+        uint16_t getOp(void) const { return m_Op; }
+
+        static const char* kindToString(Kind kind)
+        {
+            switch (kind)
+            {
+                case Kind::ILLEGAL_OPCODE:
+                    return "illegal_opcode";
+                case Kind::STACK_OVERFLOW:
+                    return "stack_overflow";
+                case Kind::STACK_UNDERFLOW:
+                    return "stack_underflow";
+                case Kind::MEMORY_OUT_OF_BOUNDS:
+                    return "memory_out_of_bounds";
+            }
+            return "unknown";
+        }
+
+    private:
+        Kind m_Kind;
+        uint16_t m_PC;
+        uint16_t m_Op;
+};
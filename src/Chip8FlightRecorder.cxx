@@ -0,0 +1,34 @@
+#include <algorithm>
+
+#include <fmt/core.h>
+
+#include "Chip8FlightRecorder.hxx"
+#include "Chip8Disassembler.hxx"
+
+Chip8FlightRecorder::Chip8FlightRecorder()
+{
+    reset();
+}
+
+void Chip8FlightRecorder::reset(void)
+{
+    m_EntryCnt = 0;
+    m_Entries.fill({0, 0, 0, 0, 0});
+}
+
+uint64_t Chip8FlightRecorder::getEntryCount(void) const
+{
+    return m_EntryCnt;
+}
+
+void Chip8FlightRecorder::dump(std::ostream& os) const
+{
+    uint64_t cnt = std::min<uint64_t>(m_EntryCnt, ENTRY_CNT);
+    for (uint64_t n = m_EntryCnt - cnt; n < m_EntryCnt; n++)
+    {
+        const Entry& e = m_Entries[n & (ENTRY_CNT - 1)];
+        os << fmt::format("{:>6} 0x{:03X}: 0x{:04X} {:<18} I=0x{:03X} VF=0x{:02X}\n",
+                static_cast<int64_t>(n) - static_cast<int64_t>(m_EntryCnt) + 1,
+                e.pc, e.op, Chip8Disassembler::disassemble(e.op), e.i, e.vf);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <ostream>
+
+// Always on ring of the last ENTRY_CNT executed instructions, for crash
+// reports. Recording is one 8 byte store, no allocation and no branches.
+class Chip8FlightRecorder
+{
+    public:
+        static constexpr uint32_t ENTRY_CNT = 4096;
+        static_assert(0 == (ENTRY_CNT & (ENTRY_CNT - 1)), "ENTRY_CNT must be a power of 2");
+
+        typedef struct
+        {
+            uint16_t pc;
+            uint16_t op;
+            uint16_t i;
+            uint8_t vf;
+            uint8_t reserved;
+        } Entry;
+
+        Chip8FlightRecorder();
+
+        // state before the instruction at pc executes
+        inline void record(uint16_t pc, uint16_t op, uint16_t i, uint8_t vf)
+        {
+            m_Entries[m_EntryCnt & (ENTRY_CNT - 1)] = {pc, op, i, vf, 0};
+            m_EntryCnt++;
+        }
+
+        void reset(void);
+        uint64_t getEntryCount(void) const;
+        // oldest first, the last line is the most recent instruction
+        void dump(std::ostream& os) const;
+
+    private:
+        uint64_t m_EntryCnt;
+        std::array<Entry, ENTRY_CNT> m_Entries;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "Chip8State.hxx"
+
+// A Chip8State whose memory is split in PAGE_SIZE_B pages shared
+// copy-on-write with the Chip8 it was forked from and with every other fork
+// of it. Only the screen, registers, stack, timers and keyboard are copied
+// when forking, a page is copied once the first time a Chip8 running the
+// fork writes to it. Pages are never modified after they are shared, so forks
+// can be copied and read from any thread.
+struct Chip8Fork
+{
+    static constexpr std::size_t PAGE_SIZE_B = 256;
+    static constexpr std::size_t PAGE_CNT = Chip8State::MEMORY_SIZE_B/PAGE_SIZE_B;
+    // everything in Chip8State after memory is copied eagerly
+    static constexpr std::size_t CPU_OFFSET = offsetof(Chip8State, gfx);
+    static constexpr std::size_t CPU_SIZE_B = sizeof(Chip8State) - CPU_OFFSET;
+
+    typedef std::array<uint8_t, PAGE_SIZE_B> Page;
+
+    std::array<std::shared_ptr<const Page>, PAGE_CNT> pages;
+    std::array<uint8_t, CPU_SIZE_B> cpu;
+
+    // pages this fork has in common with other, the rest of memory is
+    // what the two of them wrote since they split
+    std::size_t countSharedPages(const Chip8Fork& other) const
+    {
+        std::size_t shared = 0;
+        for (std::size_t page = 0; page < PAGE_CNT; page++)
+        {
+            shared += (pages[page] == other.pages[page]) ? 1 : 0;
+        }
+        return shared;
+    }
+};
+
+static_assert(0 == (Chip8State::MEMORY_SIZE_B % Chip8Fork::PAGE_SIZE_B), "Memory has to be whole pages");
+static_assert(Chip8Fork::CPU_OFFSET == Chip8State::MEMORY_SIZE_B, "Memory has to lead Chip8State");
+static_assert(Chip8Fork::PAGE_CNT <= 16, "Dirty pages are tracked in 16 bits");
@@ -0,0 +1,111 @@
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "Chip8FrameCache.hxx"
+
+namespace
+{
+    // the cycle count is not part of the hash, a hit has to carry on from
+    // the count of the frame it replaces
+    constexpr std::size_t CYCLE_CNT_OFFSET = offsetof(Chip8State, cycleCnt) - Chip8Fork::CPU_OFFSET;
+    static_assert(offsetof(Chip8State, cycleCnt) >= Chip8Fork::CPU_OFFSET, "The cycle count has to be in the eager copy");
+}
+
+Chip8FrameCache::Chip8FrameCache(unsigned cyclesPerFrame, std::size_t capacity) :
+    m_CyclesPerFrame{cyclesPerFrame},
+    m_Capacity{capacity},
+    m_Stats{}
+{
+    if (0 == capacity)
+    {
+        throw std::runtime_error("The frame cache needs room for at least one frame");
+    }
+    m_Index.reserve(capacity);
+}
+
+bool Chip8FrameCache::runFrameCycles(Chip8& cpu)
+{
+    Key key{cpu.stateHash(), cpu.getKeys()};
+    auto found = m_Index.find(key);
+    if (m_Index.end() != found)
+    {
+        auto entry = found->second;
+        m_Entries.splice(m_Entries.begin(), m_Entries, entry);
+        uint64_t cycleCnt = cpu.getCycleCount() + m_CyclesPerFrame;
+        std::memcpy(entry->result.cpu.data() + CYCLE_CNT_OFFSET, &cycleCnt, sizeof(cycleCnt));
+        cpu.loadFork(entry->result);
+        m_Stats.hits++;
+        return true;
+    }
+
+    // a fault leaves the cache as it was
+    for (unsigned cnt = 0; cnt < m_CyclesPerFrame; cnt++)
+    {
+        cpu.emulateCycle();
+    }
+    m_Stats.misses++;
+
+    // the least recently used entry is reused in place, so a full cache no
+    // longer allocates
+    if (m_Entries.size() == m_Capacity)
+    {
+        m_Index.erase(m_Entries.back().key);
+        m_Entries.splice(m_Entries.begin(), m_Entries, std::prev(m_Entries.end()));
+        m_Stats.evictions++;
+    }
+    else
+    {
+        m_Entries.emplace_front();
+    }
+    m_Entries.front().key = key;
+    cpu.fork(m_Entries.front().result);
+    m_Index.emplace(key, m_Entries.begin());
+    return false;
+}
+
+void Chip8FrameCache::clear(void)
+{
+    m_Index.clear();
+    m_Entries.clear();
+}
+
+const Chip8FrameCache::Stats& Chip8FrameCache::getStats(void) const
+{
+    return m_Stats;
+}
+
+double Chip8FrameCache::getHitRate(void) const
+{
+    uint64_t frames = m_Stats.hits + m_Stats.misses;
+    return (0 == frames) ? 0.0 : static_cast<double>(m_Stats.hits)/static_cast<double>(frames);
+}
+
+std::size_t Chip8FrameCache::size(void) const
+{
+    return m_Entries.size();
+}
+
+std::size_t Chip8FrameCache::getCapacity(void) const
+{
+    return m_Capacity;
+}
+
+// Pages are shared between entries and with the running Chip8, each one is
+// counted once. A list node and an index node per entry.
+std::size_t Chip8FrameCache::getBytes(void) const
+{
+    std::unordered_set<const void*> pages;
+    for (const auto& entry : m_Entries)
+    {
+        for (const auto& page : entry.result.pages)
+        {
+            pages.insert(page.get());
+        }
+    }
+    return pages.size()*Chip8Fork::PAGE_SIZE_B +
+        m_Entries.size()*(sizeof(Entry) + 2*sizeof(void*)) +
+        m_Index.size()*(sizeof(Key) + 2*sizeof(void*)) + m_Index.bucket_count()*sizeof(void*);
+}
@@ -0,0 +1,331 @@
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "Chip8Headless.hxx"
+#include "Chip8Probes.hxx"
+#include "Chip8SaveState.hxx"
+
+Chip8Headless::Chip8Headless(unsigned clkHz) :
+    m_ClkHz{clkHz},
+    m_CyclesPerFrame{std::max(1U, clkHz/Chip8::TIMER_HZ)},
+    m_LoggerName{fmt::format("{}-Chip8Headless", getpid())},
+    m_Logger{spdlog::get(m_LoggerName)},
+    m_FrameCnt{0},
+    m_CycleInFrame{0},
+    m_CyclesRun{0},
+    m_FramesRun{0},
+    m_IsStopOnHalt{false},
+    m_Elapsed{0}
+{
+    // shared by every runner of the process
+    if (nullptr == m_Logger)
+    {
+        m_Logger = spdlog::stderr_color_mt(m_LoggerName);
+    }
+    cpu = std::make_unique<Chip8>(m_Logger);
+    cpu->setRandomSeed(0, 0);
+}
+
+void Chip8Headless::loadRom(const std::string& romPath)
+{
+    cpu->loadRom(romPath);
+}
+
+void Chip8Headless::loadWorkload(const WorkloadGenerator::Params& params)
+{
+    cpu->loadRom(WorkloadGenerator::generate(params).rom);
+}
+
+// Stop before executing a jump to itself, that is how most ROMs (and all
+// generated workloads) end
+void Chip8Headless::setStopOnHalt(bool isStopOnHalt)
+{
+    m_IsStopOnHalt = isStopOnHalt;
+}
+
+// The runner starts from seed 0 stream 0, so runs are reproducible unless
+// seeded differently
+void Chip8Headless::setRandomSeed(uint64_t seed, uint64_t stream)
+{
+    cpu->setRandomSeed(seed, stream);
+}
+
+void Chip8Headless::loadInputScript(const std::string& scriptPath)
+{
+    m_InputScript.load(scriptPath);
+}
+
+// Replaces the input script, the ROM has to be loaded and the runner has to
+// run at the clock the movie was recorded at
+void Chip8Headless::loadMovie(const Chip8Movie& movie)
+{
+    if (movie.getClkHz() != m_ClkHz)
+    {
+        throw std::runtime_error(fmt::format("The movie was recorded at {}Hz, the runner runs at {}Hz",
+                    movie.getClkHz(), m_ClkHz));
+    }
+    if (movie.getRomHash() != cpu->getRomHash())
+    {
+        throw std::runtime_error(fmt::format("The movie belongs to ROM 0x{:016X}, the loaded ROM is 0x{:016X}",
+                    movie.getRomHash(), cpu->getRomHash()));
+    }
+    cpu->setRandomSeed(movie.getSeed(), movie.getStream());
+    m_Movie = std::make_unique<Chip8Movie>(movie);
+}
+
+// True once every frame of the movie ran and the machine ended in the state
+// the recording did
+bool Chip8Headless::isMovieVerified(void) const
+{
+    return m_Movie and (m_FrameCnt == m_Movie->getFrameCount()) and (0 == m_CycleInFrame) and
+        (cpu->stateHash() == m_Movie->getFinalStateHash());
+}
+
+// Counters only cover runCycles(), not loading or reporting
+void Chip8Headless::enablePerfCounters(void)
+{
+    m_PerfCounters = std::make_unique<PerfCounters>();
+}
+
+void Chip8Headless::enableStackSampler(unsigned periodCycles)
+{
+    m_StackSampler = std::make_unique<Chip8StackSampler>(periodCycles);
+}
+
+void Chip8Headless::writeFoldedStacks(std::ostream& os) const
+{
+    if (not m_StackSampler)
+    {
+        throw std::runtime_error("Stack sampling was not enabled");
+    }
+    m_StackSampler->writeFolded(os);
+}
+
+// On a ROM fault the machine state and the last instructions go to path
+void Chip8Headless::setCrashDumpPath(const std::string& path)
+{
+    cpu->setCrashDumpPath(path);
+}
+
+void Chip8Headless::saveState(const std::string& path) const
+{
+    Chip8SaveState::save(*cpu, path);
+}
+
+// Frames are counted from the start of the ROM, so input scripts keep their
+// frame numbers when a run resumes from a state saved at the same clock
+void Chip8Headless::loadState(const std::string& path)
+{
+    Chip8SaveState::load(*cpu, path);
+    m_FrameCnt = cpu->getCycleCount()/m_CyclesPerFrame;
+    m_CycleInFrame = static_cast<unsigned>(cpu->getCycleCount()%m_CyclesPerFrame);
+}
+
+// Records every frame into a rewind history, to measure what recording costs
+void Chip8Headless::enableRewind(std::size_t budget_B)
+{
+    m_Rewind = std::make_unique<Chip8Rewind>(budget_B);
+}
+
+// Frames that start from a state and keys seen before load the state they
+// ended in instead of running, for ROMs that idle in the same frames. Only
+// runs without a per-cycle tool (stop on halt, stack sampling, traces) use it.
+void Chip8Headless::enableFrameCache(std::size_t capacity)
+{
+    m_FrameCache = std::make_unique<Chip8FrameCache>(m_CyclesPerFrame, capacity);
+}
+
+// Records every cycle from now on, keeping the last `capacity` ones
+void Chip8Headless::enableTrace(const std::string& tracePath, uint32_t capacity)
+{
+    m_TraceRecorder = std::make_unique<Chip8TraceRecorder>(tracePath, capacity);
+}
+
+// Returns the number of cycles executed, less than batch only when halted
+unsigned Chip8Headless::executeBatch(unsigned batch)
+{
+    CHIP8_PROBE1(batch_start, batch);
+    if (not m_IsStopOnHalt and not m_StackSampler and not m_TraceRecorder)
+    {
+        // a whole frame, the batch starts at the start of it
+        if (m_FrameCache and (m_CyclesPerFrame == batch))
+        {
+            m_FrameCache->runFrameCycles(*cpu);
+            CHIP8_PROBE1(batch_end, batch);
+            return batch;
+        }
+        for (unsigned cnt = 0; cnt < batch; cnt++)
+        {
+            cpu->emulateCycle();
+        }
+        CHIP8_PROBE1(batch_end, batch);
+        return batch;
+    }
+
+    unsigned cnt = 0;
+    for (; cnt < batch; cnt++)
+    {
+        if (m_IsStopOnHalt and cpu->isHalted())
+        {
+            break;
+        }
+        if (m_StackSampler)
+        {
+            m_StackSampler->tick(*cpu);
+        }
+        if (m_TraceRecorder)
+        {
+            m_TraceRecorder->emulateCycle(*cpu);
+        }
+        else
+        {
+            cpu->emulateCycle();
+        }
+    }
+    CHIP8_PROBE1(batch_end, cnt);
+    return cnt;
+}
+
+void Chip8Headless::runCycles(uint64_t cycles)
+{
+    if (m_PerfCounters)
+    {
+        m_PerfCounters->start();
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (cycles > 0)
+    {
+        if ((0 == m_CycleInFrame) and m_Movie)
+        {
+            cpu->setKeys(m_Movie->getKeys(m_FrameCnt));
+        }
+        else if (0 == m_CycleInFrame)
+        {
+            m_InputScript.apply(m_FrameCnt, *cpu);
+        }
+
+        // run to the end of the current frame or until we are out of cycles
+        unsigned batch = static_cast<unsigned>(
+                std::min<uint64_t>(cycles, m_CyclesPerFrame - m_CycleInFrame));
+        unsigned cnt = executeBatch(batch);
+        m_CycleInFrame += cnt;
+        m_CyclesRun += cnt;
+        if (cnt < batch)
+        {
+            break;
+        }
+        cycles -= batch;
+
+        if (m_CyclesPerFrame == m_CycleInFrame)
+        {
+            cpu->decrementTimers();
+            m_CycleInFrame = 0;
+            m_FrameCnt++;
+            m_FramesRun++;
+            if (m_Rewind)
+            {
+                Chip8State state;
+                cpu->saveState(state);
+                m_Rewind->record(state);
+            }
+        }
+    }
+    m_Elapsed += std::chrono::steady_clock::now() - start;
+    if (m_PerfCounters)
+    {
+        m_PerfCounters->stop();
+    }
+}
+
+void Chip8Headless::runFrames(uint64_t frames)
+{
+    // finish a partially executed frame first so frame boundaries stay aligned
+    uint64_t cycles = frames*m_CyclesPerFrame;
+    if ((frames > 0) and (0 != m_CycleInFrame))
+    {
+        cycles -= m_CycleInFrame;
+    }
+    runCycles(cycles);
+}
+
+void Chip8Headless::printReport(std::ostream& os, bool showGfx) const
+{
+    os << fmt::format("cycles: {}\n", cpu->getCycleCount());
+    os << fmt::format("frames: {}\n", m_FrameCnt);
+    os << fmt::format("halted: {}\n", cpu->isHalted());
+    os << fmt::format("elapsed_s: {:.6f}\n", getElapsedSeconds());
+    os << fmt::format("mips: {:.3f}\n", getMips());
+    os << fmt::format("PC: 0x{:03X}\n", cpu->getPC());
+    os << fmt::format("I: 0x{:03X}\n", cpu->getI());
+    os << fmt::format("SP: 0x{:02X}\n", cpu->getSP());
+    os << fmt::format("DT: 0x{:02X}\n", cpu->getDelayTimer());
+    os << fmt::format("ST: 0x{:02X}\n", cpu->getSoundTimer());
+    for (uint8_t i = 0; i < Chip8::REGISTER_CNT; i++)
+    {
+        os << fmt::format("V{:X}: 0x{:02X}\n", i, cpu->getV(i));
+    }
+    os << fmt::format("gfx_hash: 0x{:016X}\n", cpu->gfxHash());
+    os << fmt::format("state_hash: 0x{:016X}\n", cpu->stateHash());
+    if (m_Rewind)
+    {
+        const auto& stats = m_Rewind->getStats();
+        double frames = static_cast<double>(std::max<uint64_t>(1, stats.frames));
+        os << fmt::format("rewind_frames: {}\n", m_Rewind->getDepth() + 1);
+        os << fmt::format("rewind_bytes: {}\n", m_Rewind->getUsedBytes());
+        os << fmt::format("rewind_bytes_per_frame: {:.1f}\n", static_cast<double>(stats.bytes)/frames);
+        os << fmt::format("rewind_record_us_per_frame: {:.3f}\n", 1e6*stats.recordTime.count()/frames);
+    }
+    if (m_FrameCache)
+    {
+        const auto& stats = m_FrameCache->getStats();
+        os << fmt::format("frame_cache_hits: {}\n", stats.hits);
+        os << fmt::format("frame_cache_misses: {}\n", stats.misses);
+        os << fmt::format("frame_cache_hit_rate: {:.3f}\n", m_FrameCache->getHitRate());
+        os << fmt::format("frame_cache_evictions: {}\n", stats.evictions);
+        os << fmt::format("frame_cache_entries: {}\n", m_FrameCache->size());
+        os << fmt::format("frame_cache_bytes: {}\n", m_FrameCache->getBytes());
+        os << fmt::format("frame_cache_cycles_skipped: {}\n", stats.hits*m_CyclesPerFrame);
+    }
+    if (m_PerfCounters)
+    {
+        os << m_PerfCounters->report(m_CyclesRun, m_FramesRun);
+    }
+    if (showGfx)
+    {
+        os << cpu->gfxString() << "\n";
+    }
+}
+
+const Chip8& Chip8Headless::getCpu(void) const
+{
+    return *cpu;
+}
+
+uint64_t Chip8Headless::getFrameCount(void) const
+{
+    return m_FrameCnt;
+}
+
+unsigned Chip8Headless::getCyclesPerFrame(void) const
+{
+    return m_CyclesPerFrame;
+}
+
+double Chip8Headless::getElapsedSeconds(void) const
+{
+    return m_Elapsed.count();
+}
+
+double Chip8Headless::getMips(void) const
+{
+    if (0.0 == m_Elapsed.count())
+    {
+        return 0.0;
+    }
+    return static_cast<double>(m_CyclesRun)/m_Elapsed.count()/1e6;
+}
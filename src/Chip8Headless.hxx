@@ -0,0 +1,77 @@
+#pragma once
+#include <memory>
+#include <ostream>
+#include <chrono>
+#include <spdlog/logger.h>
+
+#include "Chip8.hxx"
+#include "InputScript.hxx"
+#include "PerfCounters.hxx"
+#include "Chip8StackSampler.hxx"
+#include "Chip8TraceRecorder.hxx"
+#include "Chip8Rewind.hxx"
+#include "Chip8Movie.hxx"
+#include "Chip8FrameCache.hxx"
+#include "WorkloadGenerator.hxx"
+
+// Runs a ROM without SDL, as fast as the host allows. Time is measured in
+// emulated frames: every frame executes clkHz/60 cycles and ticks the timers
+// once, so two runs with the same ROM and input script end in the same state.
+class Chip8Headless
+{
+    public:
+        static constexpr unsigned DEFAULT_CLK_HZ = 540;
+
+        Chip8Headless(unsigned clkHz = DEFAULT_CLK_HZ);
+        void loadRom(const std::string& romPath);
+        void loadWorkload(const WorkloadGenerator::Params& params);
+        void loadInputScript(const std::string& scriptPath);
+        void loadMovie(const Chip8Movie& movie);
+        bool isMovieVerified(void) const;
+        void setStopOnHalt(bool isStopOnHalt);
+        void setRandomSeed(uint64_t seed, uint64_t stream);
+        void enablePerfCounters(void);
+        void enableStackSampler(unsigned periodCycles);
+        void writeFoldedStacks(std::ostream& os) const;
+        void enableTrace(const std::string& tracePath, uint32_t capacity);
+        void setCrashDumpPath(const std::string& path);
+        void enableRewind(std::size_t budget_B);
+        void enableFrameCache(std::size_t capacity);
+        void saveState(const std::string& path) const;
+        void loadState(const std::string& path);
+        void runCycles(uint64_t cycles);
+        void runFrames(uint64_t frames);
+        void printReport(std::ostream& os, bool showGfx = false) const;
+
+        const Chip8& getCpu(void) const;
+        uint64_t getFrameCount(void) const;
+        unsigned getCyclesPerFrame(void) const;
+        double getElapsedSeconds(void) const;
+        double getMips(void) const;
+
+    private:
+        unsigned executeBatch(unsigned batch);
+
+        unsigned m_ClkHz;
+        unsigned m_CyclesPerFrame;
+        // https://github.com/gabime/spdlog/wiki/2.-Creating-loggers
+        std::string m_LoggerName;
+        std::shared_ptr<spdlog::logger> m_Logger;
+        std::unique_ptr<Chip8> cpu;
+        InputScript m_InputScript;
+        std::unique_ptr<PerfCounters> m_PerfCounters;
+        std::unique_ptr<Chip8StackSampler> m_StackSampler;
+        std::unique_ptr<Chip8TraceRecorder> m_TraceRecorder;
+        std::unique_ptr<Chip8Rewind> m_Rewind;
+        std::unique_ptr<Chip8Movie> m_Movie;
+        std::unique_ptr<Chip8FrameCache> m_FrameCache;
+
+        uint64_t m_FrameCnt;
+        unsigned m_CycleInFrame;
+        // what this process ran, a loaded state counts in m_FrameCnt and the
+        // cycle count but not here
+        uint64_t m_CyclesRun;
+        uint64_t m_FramesRun;
+        bool m_IsStopOnHalt;
+        std::chrono::duration<double> m_Elapsed;
+};
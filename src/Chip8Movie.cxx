@@ -0,0 +1,147 @@
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "Chip8Movie.hxx"
+
+Chip8Movie::Chip8Movie(uint64_t romHash, uint64_t seed, uint64_t stream, unsigned clkHz) :
+    m_RomHash{romHash},
+    m_Seed{seed},
+    m_Stream{stream},
+    m_ClkHz{clkHz},
+    m_FinalStateHash{0}
+{
+}
+
+Chip8Movie::Chip8Movie(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (not file.good())
+    {
+        throw std::runtime_error(fmt::format("Unable to open movie {}", path));
+    }
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if ((sizeof(header) != static_cast<std::size_t>(file.gcount())) or (MAGIC != header.magic))
+    {
+        throw std::runtime_error(fmt::format("{} is not a movie", path));
+    }
+    if (header.version > FORMAT_VERSION)
+    {
+        throw std::runtime_error(fmt::format("{} is a version {} movie, this is version {}",
+                    path, header.version, FORMAT_VERSION));
+    }
+    // the frame count is checked against the file before anything is
+    // allocated for it
+    file.seekg(0, std::ios::end);
+    auto fileSize = static_cast<uint64_t>(file.tellg());
+    if ((header.headerSize < sizeof(header)) or (header.headerSize > fileSize) or
+            (0 != (fileSize - header.headerSize) % sizeof(uint16_t)) or
+            (header.frameCnt != (fileSize - header.headerSize)/sizeof(uint16_t)))
+    {
+        throw std::runtime_error(fmt::format("{} is truncated or corrupt, its header says {} frames",
+                    path, header.frameCnt));
+    }
+    m_RomHash = header.romHash;
+    m_Seed = header.seed;
+    m_Stream = header.stream;
+    m_ClkHz = header.clkHz;
+    m_FinalStateHash = header.finalStateHash;
+
+    m_Keys.resize(header.frameCnt);
+    file.seekg(header.headerSize);
+    file.read(reinterpret_cast<char*>(m_Keys.data()),
+            static_cast<std::streamsize>(m_Keys.size()*sizeof(uint16_t)));
+    if (not file.good())
+    {
+        throw std::runtime_error(fmt::format("Unable to read the {} frames of movie {}", header.frameCnt, path));
+    }
+}
+
+void Chip8Movie::save(const std::string& path) const
+{
+    FileHeader header{};
+    header.magic = MAGIC;
+    header.version = FORMAT_VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.romHash = m_RomHash;
+    header.seed = m_Seed;
+    header.stream = m_Stream;
+    header.clkHz = m_ClkHz;
+    header.frameCnt = m_Keys.size();
+    header.finalStateHash = m_FinalStateHash;
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_Keys.data()),
+                static_cast<std::streamsize>(m_Keys.size()*sizeof(uint16_t)));
+        if (not file.good())
+        {
+            throw std::runtime_error(fmt::format("Unable to write movie {}", tmpPath));
+        }
+    }
+    if (0 != std::rename(tmpPath.c_str(), path.c_str()))
+    {
+        throw std::runtime_error(fmt::format("Unable to rename {} to {}: {}",
+                    tmpPath, path, std::strerror(errno)));
+    }
+}
+
+void Chip8Movie::record(uint16_t keys)
+{
+    m_Keys.push_back(keys);
+}
+
+void Chip8Movie::truncate(uint64_t frames)
+{
+    if (frames < m_Keys.size())
+    {
+        m_Keys.resize(frames);
+    }
+}
+
+void Chip8Movie::setFinalStateHash(uint64_t hash)
+{
+    m_FinalStateHash = hash;
+}
+
+uint16_t Chip8Movie::getKeys(uint64_t frame) const
+{
+    return (frame < m_Keys.size()) ? m_Keys[frame] : 0;
+}
+
+uint64_t Chip8Movie::getFrameCount(void) const
+{
+    return m_Keys.size();
+}
+
+uint64_t Chip8Movie::getRomHash(void) const
+{
+    return m_RomHash;
+}
+
+uint64_t Chip8Movie::getSeed(void) const
+{
+    return m_Seed;
+}
+
+uint64_t Chip8Movie::getStream(void) const
+{
+    return m_Stream;
+}
+
+unsigned Chip8Movie::getClkHz(void) const
+{
+    return m_ClkHz;
+}
+
+uint64_t Chip8Movie::getFinalStateHash(void) const
+{
+    return m_FinalStateHash;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// A recorded session that replays bit-exactly: the ROM hash, the CXkk seed
+// and stream, the clock and the keys held in every 60Hz frame, a 64 byte
+// header followed by one 16-bit key mask per frame. A frame is the same as in the
+// headless runner: the keys are set, clkHz/60 cycles run and the timers tick
+// once. The machine starts from reset, the header ends with the
+// Chip8::stateHash() the recording finished in, so a replay can tell whether
+// it diverged.
+class Chip8Movie
+{
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+        static constexpr std::array<char, 8> MAGIC = {'C', 'H', '8', 'M', 'O', 'V', 'I', 'E'};
+
+        typedef struct FileHeader
+        {
+            std::array<char, 8> magic;
+            uint32_t version;
+            // offset of the key masks
+            uint32_t headerSize;
+            uint64_t romHash;
+            uint64_t seed;
+            uint32_t clkHz;
+            uint32_t reserved0;
+            uint64_t frameCnt;
+            uint64_t finalStateHash;
+            // random stream, zero before it was recorded
+            uint64_t stream;
+        } FileHeader;
+        static_assert(sizeof(FileHeader) == 64);
+        static_assert(std::is_trivially_copyable_v<FileHeader>);
+
+        Chip8Movie(uint64_t romHash, uint64_t seed, uint64_t stream, unsigned clkHz);
+        explicit Chip8Movie(const std::string& path);
+        // Written to a temporary file first, like save states
+        void save(const std::string& path) const;
+
+        void record(uint16_t keys);
+        // drops every frame from `frames` on, for a recording that rewound
+        void truncate(uint64_t frames);
+        void setFinalStateHash(uint64_t hash);
+
+        // no keys past the last frame
+        uint16_t getKeys(uint64_t frame) const;
+        uint64_t getFrameCount(void) const;
+        uint64_t getRomHash(void) const;
+        uint64_t getSeed(void) const;
+        uint64_t getStream(void) const;
+        unsigned getClkHz(void) const;
+        uint64_t getFinalStateHash(void) const;
+
+    private:
+        uint64_t m_RomHash;
+        uint64_t m_Seed;
+        uint64_t m_Stream;
+        unsigned m_ClkHz;
+        uint64_t m_FinalStateHash;
+        std::vector<uint16_t> m_Keys;
+};
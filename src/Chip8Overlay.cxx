@@ -0,0 +1,98 @@
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "Chip8Overlay.hxx"
+#include "Chip8.hxx"
+
+Chip8Overlay::Chip8Overlay(std::shared_ptr<SDL_Renderer> renderer) :
+    m_Renderer{renderer},
+    m_Texture{nullptr, SDL_DestroyTexture},
+    m_IsVisible{false},
+    m_RectCnt{0}
+{
+    m_Texture.reset(SDL_CreateTexture(
+                m_Renderer.get(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                (2*MARGIN + static_cast<int>(CHARS_PER_LINE)*GLYPH_WIDTH)*FONT_PIXEL_SIZE,
+                (2*MARGIN + static_cast<int>(LINE_CNT)*GLYPH_HEIGHT)*FONT_PIXEL_SIZE));
+    if (nullptr == m_Texture)
+    {
+        throw std::runtime_error(fmt::format("Unable to create the overlay texture: {}", SDL_GetError()));
+    }
+    SDL_SetTextureBlendMode(m_Texture.get(), SDL_BLENDMODE_BLEND);
+}
+
+void Chip8Overlay::toggle(void)
+{
+    m_IsVisible = not m_IsVisible;
+}
+
+bool Chip8Overlay::isVisible(void) const
+{
+    return m_IsVisible;
+}
+
+// Digits use the font sprites, '.' is a single font pixel on the baseline and
+// anything else is left blank
+void Chip8Overlay::addLine(std::size_t line, double value)
+{
+    std::array<char, CHARS_PER_LINE> text;
+    auto end = fmt::format_to_n(text.begin(), text.size(), "{:.2f}", value).out;
+    int y = MARGIN + static_cast<int>(line)*GLYPH_HEIGHT;
+    int x = MARGIN;
+    for (auto c = text.begin(); c != end; c++, x += GLYPH_WIDTH)
+    {
+        if ('.' == *c)
+        {
+            m_Rects[m_RectCnt++] = {(x + 1)*FONT_PIXEL_SIZE, (y + 4)*FONT_PIXEL_SIZE, 
+                FONT_PIXEL_SIZE, FONT_PIXEL_SIZE};
+            continue;
+        }
+        if ((*c < '0') or (*c > '9'))
+        {
+            continue;
+        }
+        const auto& sprite = Chip8::FONT_SPRITES[static_cast<std::size_t>(*c - '0')];
+        for (int row = 0; row < 5; row++)
+        {
+            for (int col = 0; col < 4; col++)
+            {
+                if (sprite[static_cast<std::size_t>(row)] & (0x80 >> col))
+                {
+                    m_Rects[m_RectCnt++] = {(x + col)*FONT_PIXEL_SIZE, (y + row)*FONT_PIXEL_SIZE, 
+                        FONT_PIXEL_SIZE, FONT_PIXEL_SIZE};
+                }
+            }
+        }
+    }
+}
+
+void Chip8Overlay::update(double mips, double fps, double frameTime_ms, double jitter_ms)
+{
+    m_RectCnt = 0;
+    addLine(0, mips);
+    addLine(1, fps);
+    addLine(2, frameTime_ms);
+    addLine(3, jitter_ms);
+
+    SDL_Texture* target = SDL_GetRenderTarget(m_Renderer.get());
+    SDL_SetRenderTarget(m_Renderer.get(), m_Texture.get());
+    // translucent backdrop keeps the numbers readable over any screen
+    SDL_SetRenderDrawColor(m_Renderer.get(), 0x00, 0x00, 0x80, 0xA0);
+    SDL_RenderClear(m_Renderer.get());
+    SDL_SetRenderDrawColor(m_Renderer.get(), 0xFF, 0xFF, 0x00, 0xFF);
+    SDL_RenderFillRects(m_Renderer.get(), m_Rects.data(), static_cast<int>(m_RectCnt));
+    SDL_SetRenderTarget(m_Renderer.get(), target);
+}
+
+void Chip8Overlay::composite(void)
+{
+    if (not m_IsVisible)
+    {
+        return;
+    }
+    int width, height;
+    SDL_QueryTexture(m_Texture.get(), nullptr, nullptr, &width, &height);
+    SDL_Rect dst{0, 0, width, height};
+    SDL_RenderCopy(m_Renderer.get(), m_Texture.get(), nullptr, &dst);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <SDL.h>
+
+// Performance numbers drawn with the Chip8 hex font into their own texture.
+// The texture is only redrawn by update(), compositing it is one copy, and
+// neither allocates. Lines from the top: MIPS, FPS, frame time and frame time
+// jitter, both in ms.
+class Chip8Overlay
+{
+    public:
+        static constexpr int FONT_PIXEL_SIZE = 4;
+        static constexpr std::size_t LINE_CNT = 4;
+        static constexpr std::size_t CHARS_PER_LINE = 8;
+
+        Chip8Overlay(std::shared_ptr<SDL_Renderer> renderer);
+        void toggle(void);
+        bool isVisible(void) const;
+        void update(double mips, double fps, double frameTime_ms, double jitter_ms);
+        // Copies the overlay onto the current render target, if visible
+        void composite(void);
+
+    private:
+        // glyphs are 4x5 font pixels plus one column and row of spacing
+        static constexpr int GLYPH_WIDTH = 5;
+        static constexpr int GLYPH_HEIGHT = 6;
+        static constexpr int MARGIN = 2;
+
+        void addLine(std::size_t line, double value);
+
+        std::shared_ptr<SDL_Renderer> m_Renderer;
+        std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)> m_Texture;
+        bool m_IsVisible;
+        std::array<SDL_Rect, LINE_CNT*CHARS_PER_LINE*4*5> m_Rects;
+        std::size_t m_RectCnt;
+};
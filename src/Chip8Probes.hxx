@@ -0,0 +1,23 @@
+#pragma once
+
+// USDT probes of the "chip8" provider, for bpftrace and perf, e.g.
+//
+//   bpftrace -e 'usdt:./CppChip8-emulator:chip8:drw { @[arg3] = count(); }'
+//
+// A probe that is not attached is a single nop in the instruction stream and
+// its arguments are only read when it fires. Without a usable sys/sdt.h, see
+// BUILD_USDT_PROBES, the probes compile to nothing.
+#if defined(USDT_PROBES) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CHIP8_PROBE(name) DTRACE_PROBE(chip8, name)
+#define CHIP8_PROBE1(name, a1) DTRACE_PROBE1(chip8, name, a1)
+#define CHIP8_PROBE2(name, a1, a2) DTRACE_PROBE2(chip8, name, a1, a2)
+#define CHIP8_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(chip8, name, a1, a2, a3)
+#define CHIP8_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(chip8, name, a1, a2, a3, a4)
+#else
+#define CHIP8_PROBE(name) do {} while (0)
+#define CHIP8_PROBE1(name, a1) do {} while (0)
+#define CHIP8_PROBE2(name, a1, a2) do {} while (0)
+#define CHIP8_PROBE3(name, a1, a2, a3) do {} while (0)
+#define CHIP8_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#endif
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <numeric>
+
+#include <fmt/core.h>
+
+#include "Chip8Profiler.hxx"
+#include "Chip8Disassembler.hxx"
+
+Chip8Profiler::Chip8Profiler() :
+    m_OpCnt(0x10000, 0)
+{
+    reset();
+}
+
+void Chip8Profiler::reset(void)
+{
+    std::fill(m_OpCnt.begin(), m_OpCnt.end(), 0);
+    m_PcCnt.fill(0);
+    m_BlockEntryCnt.fill(0);
+    // there is no previous instruction, the first one starts a block
+    m_NextPC = 0xFFFF;
+}
+
+static uint16_t opAt(const std::array<uint8_t, Chip8Profiler::MEMORY_SIZE_B>& memory, std::size_t addr)
+{
+    return static_cast<uint16_t>((memory[addr & 0xFFF] << 8) | memory[(addr + 1) & 0xFFF]);
+}
+
+void Chip8Profiler::report(std::ostream& os, const std::array<uint8_t, MEMORY_SIZE_B>& memory) const
+{
+    uint64_t total = std::accumulate(m_PcCnt.begin(), m_PcCnt.end(), uint64_t{0});
+    auto pct = [total](uint64_t cnt)
+    {
+        return (0 == total) ? 0.0 : 100.0*static_cast<double>(cnt)/static_cast<double>(total);
+    };
+    os << fmt::format("instructions: {}\n", total);
+
+    // opcode classes
+    std::array<uint64_t, Chip8Disassembler::OP_CLASS_CNT> classCnt{};
+    for (std::size_t op = 0; op < m_OpCnt.size(); op++)
+    {
+        if (0 != m_OpCnt[op])
+        {
+            classCnt[Chip8Disassembler::opClassId(static_cast<uint16_t>(op))] += m_OpCnt[op];
+        }
+    }
+    std::vector<uint8_t> classes(classCnt.size());
+    std::iota(classes.begin(), classes.end(), 0);
+    std::stable_sort(classes.begin(), classes.end(), 
+            [&classCnt](uint8_t a, uint8_t b) { return classCnt[a] > classCnt[b]; });
+
+    os << "\n# opcode classes\n";
+    os << fmt::format("{:>14} {:>7}  {}\n", "count", "%", "class");
+    for (auto id : classes)
+    {
+        if (0 == classCnt[id])
+        {
+            break;
+        }
+        os << fmt::format("{:>14} {:>7.3f}  {}\n", 
+                classCnt[id], pct(classCnt[id]), Chip8Disassembler::opClassName(id));
+    }
+
+    // hot PCs, disassembled from memory as it is now. Self modifying code may
+    // have executed something else at the same address.
+    std::vector<uint16_t> pcs(MEMORY_SIZE_B);
+    std::iota(pcs.begin(), pcs.end(), 0);
+    std::stable_sort(pcs.begin(), pcs.end(), 
+            [this](uint16_t a, uint16_t b) { return m_PcCnt[a] > m_PcCnt[b]; });
+
+    os << fmt::format("\n# top {} PCs\n", TOP_CNT);
+    os << fmt::format("{:>14} {:>7}  {:5} {:6} {}\n", "count", "%", "addr", "op", "disassembly");
+    for (std::size_t i = 0; (i < TOP_CNT) and (0 != m_PcCnt[pcs[i]]); i++)
+    {
+        auto op = opAt(memory, pcs[i]);
+        os << fmt::format("{:>14} {:>7.3f}  0x{:03X} 0x{:04X} {}\n", 
+                m_PcCnt[pcs[i]], pct(m_PcCnt[pcs[i]]), pcs[i], op, Chip8Disassembler::disassemble(op));
+    }
+
+    // hot basic blocks. A block runs from an entry point until the first
+    // control flow instruction or the next entry point. Its weight is the
+    // number of instructions executed in it.
+    //
+    // record() only sees jumps and taken skips as entries. The instruction
+    // after a control flow instruction also leads a block, every arrival at
+    // it is a fall through from an untaken skip or a return to it.
+    typedef struct
+    {
+        uint16_t start;
+        uint16_t end;
+        uint64_t entries;
+        uint64_t instructions;
+    } Block;
+
+    auto entries = [this, &memory](std::size_t addr)
+    {
+        if ((0 != m_PcCnt[addr]) and Chip8Disassembler::isControlFlow(opAt(memory, addr - 2)))
+        {
+            return m_PcCnt[addr];
+        }
+        return m_BlockEntryCnt[addr];
+    };
+
+    std::vector<Block> blocks;
+    for (std::size_t start = 0; start < MEMORY_SIZE_B; start++)
+    {
+        if (0 == entries(start))
+        {
+            continue;
+        }
+
+        Block block{static_cast<uint16_t>(start), static_cast<uint16_t>(start), entries(start), 0};
+        for (std::size_t addr = start; addr < MEMORY_SIZE_B; addr += 2)
+        {
+            if ((addr != start) and (0 != entries(addr)))
+            {
+                break;
+            }
+            block.end = static_cast<uint16_t>(addr);
+            block.instructions += m_PcCnt[addr];
+            if (Chip8Disassembler::isControlFlow(opAt(memory, addr)))
+            {
+                break;
+            }
+        }
+        blocks.push_back(block);
+    }
+    std::stable_sort(blocks.begin(), blocks.end(), 
+            [](const Block& a, const Block& b) { return a.instructions > b.instructions; });
+
+    os << fmt::format("\n# top {} basic blocks\n", TOP_CNT);
+    for (std::size_t i = 0; (i < TOP_CNT) and (i < blocks.size()); i++)
+    {
+        const auto& block = blocks[i];
+        os << fmt::format("0x{:03X}-0x{:03X} entries: {} instructions: {} ({:.3f}%)\n",
+                block.start, block.end, block.entries, block.instructions, pct(block.instructions));
+        for (std::size_t addr = block.start; addr <= block.end; addr += 2)
+        {
+            auto op = opAt(memory, addr);
+            os << fmt::format("    0x{:03X} 0x{:04X} {:<20} {:>14}\n", 
+                    addr, op, Chip8Disassembler::disassemble(op), m_PcCnt[addr]);
+        }
+    }
+}
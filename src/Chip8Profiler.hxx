@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <vector>
+#include <ostream>
+
+// Exact execution profile, compiled in with -DBUILD_PROFILER_PACKAGE=ON.
+// Chip8 calls record() once per instruction; everything else happens when
+// the report is written.
+class Chip8Profiler
+{
+    public:
+        static constexpr std::size_t MEMORY_SIZE_B = 4096;
+        static constexpr std::size_t TOP_CNT = 20;
+
+        Chip8Profiler();
+        void reset(void);
+
+        inline void record(uint16_t pc, uint16_t op)
+        {
+            m_OpCnt[op]++;
+            m_PcCnt[pc]++;
+            // anything but falling through from the previous instruction
+            // starts a basic block
+            if (pc != m_NextPC)
+            {
+                m_BlockEntryCnt[pc]++;
+            }
+            m_NextPC = static_cast<uint16_t>((pc + 2) & 0x0FFF);
+        }
+
+        // top opcode classes, top PCs with disassembly and hot basic blocks
+        void report(std::ostream& os, const std::array<uint8_t, MEMORY_SIZE_B>& memory) const;
+
+    private:
+        std::vector<uint64_t> m_OpCnt;
+        std::array<uint64_t, MEMORY_SIZE_B> m_PcCnt;
+        std::array<uint64_t, MEMORY_SIZE_B> m_BlockEntryCnt;
+        uint16_t m_NextPC;
+};
@@ -0,0 +1,291 @@
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "Chip8Rewind.hxx"
+
+namespace
+{
+    // memory and the screen lead the state, everything after them is
+    // registers, stack, timers and keyboard
+    constexpr std::size_t MEMORY_OFFSET = offsetof(Chip8State, memory);
+    constexpr std::size_t MEMORY_SIZE = sizeof(Chip8State::memory);
+    constexpr std::size_t GFX_OFFSET = offsetof(Chip8State, gfx);
+    constexpr std::size_t GFX_SIZE = sizeof(Chip8State::gfx);
+    constexpr std::size_t REST_OFFSET = GFX_OFFSET + GFX_SIZE;
+    constexpr std::size_t REST_SIZE = sizeof(Chip8State) - REST_OFFSET;
+    static_assert((0 == MEMORY_OFFSET) and (GFX_OFFSET == MEMORY_SIZE));
+
+    // keyframes are deltas against this, padding included
+    const Chip8State ZERO_STATE{};
+
+    constexpr uint16_t SPARSE_END = 0xFFFF;
+    // equal bytes shorter than this do not end a run, the run header costs 4
+    constexpr std::size_t SPARSE_GAP = 4;
+
+    void put16(std::vector<uint8_t>& out, std::size_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value & 0xFF));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    uint16_t get16(const uint8_t*& data)
+    {
+        uint16_t value = static_cast<uint16_t>(data[0] | (data[1] << 8));
+        data += 2;
+        return value;
+    }
+
+    // (skip, length, length XORed bytes)*, SPARSE_END
+    void encodeSparse(const uint8_t* a, const uint8_t* b, std::size_t size, std::vector<uint8_t>& out)
+    {
+        std::size_t last = 0;
+        std::size_t i = 0;
+        while (i < size)
+        {
+            // most of memory is unchanged, skip it a word at a time
+            if ((i + 8 <= size) and (0 == std::memcmp(a + i, b + i, 8)))
+            {
+                i += 8;
+                continue;
+            }
+            if (a[i] == b[i])
+            {
+                i++;
+                continue;
+            }
+            std::size_t start = i;
+            std::size_t end = i + 1;
+            // end moves with every changed byte found, so the loop keeps going
+            // until SPARSE_GAP equal bytes in a row
+            for (std::size_t j = end; (j < size) and (j < end + SPARSE_GAP); j++)
+            {
+                if (a[j] != b[j])
+                {
+                    end = j + 1;
+                }
+            }
+            put16(out, start - last);
+            put16(out, end - start);
+            for (std::size_t j = start; j < end; j++)
+            {
+                out.push_back(a[j] ^ b[j]);
+            }
+            last = end;
+            i = end;
+        }
+        put16(out, SPARSE_END);
+    }
+
+    void applySparse(const uint8_t*& data, uint8_t* dst)
+    {
+        std::size_t pos = 0;
+        for (uint16_t skip = get16(data); SPARSE_END != skip; skip = get16(data))
+        {
+            pos += skip;
+            uint16_t len = get16(data);
+            for (uint16_t i = 0; i < len; i++)
+            {
+                dst[pos++] ^= *data++;
+            }
+        }
+    }
+
+    // (count, XORed byte)* covering exactly size bytes
+    void encodeRle(const uint8_t* a, const uint8_t* b, std::size_t size, std::vector<uint8_t>& out)
+    {
+        std::size_t i = 0;
+        while (i < size)
+        {
+            uint8_t value = a[i] ^ b[i];
+            std::size_t cnt = 1;
+            while ((i + cnt < size) and (cnt < 255) and (value == (a[i + cnt] ^ b[i + cnt])))
+            {
+                cnt++;
+            }
+            out.push_back(static_cast<uint8_t>(cnt));
+            out.push_back(value);
+            i += cnt;
+        }
+    }
+
+    void applyRle(const uint8_t*& data, uint8_t* dst, std::size_t size)
+    {
+        std::size_t pos = 0;
+        while (pos < size)
+        {
+            uint8_t cnt = *data++;
+            uint8_t value = *data++;
+            if (0 != value)
+            {
+                for (uint8_t i = 0; i < cnt; i++)
+                {
+                    dst[pos + i] ^= value;
+                }
+            }
+            pos += cnt;
+        }
+    }
+}
+
+Chip8Rewind::Chip8Rewind(std::size_t budget_B) :
+    m_Ring(budget_B),
+    m_Head{0},
+    m_SinceKeyframe{0},
+    m_Stats{}
+{
+    if (budget_B < MIN_BUDGET_B)
+    {
+        throw std::runtime_error(fmt::format(
+                    "Rewind budget of {} bytes is below the minimum of {} bytes", budget_B, MIN_BUDGET_B));
+    }
+    // the worst case of a keyframe plus a delta, so recording never allocates
+    m_Scratch.reserve(4*sizeof(Chip8State));
+}
+
+void Chip8Rewind::clear(void)
+{
+    m_Entries.clear();
+    m_Head = 0;
+    m_SinceKeyframe = 0;
+}
+
+void Chip8Rewind::encode(const Chip8State& from, const Chip8State& to, std::vector<uint8_t>& out)
+{
+    const auto* a = reinterpret_cast<const uint8_t*>(&from);
+    const auto* b = reinterpret_cast<const uint8_t*>(&to);
+    encodeSparse(a + MEMORY_OFFSET, b + MEMORY_OFFSET, MEMORY_SIZE, out);
+    encodeRle(a + GFX_OFFSET, b + GFX_OFFSET, GFX_SIZE, out);
+    encodeSparse(a + REST_OFFSET, b + REST_OFFSET, REST_SIZE, out);
+}
+
+// XORs an encoded delta into state, which turns one end of it into the other
+void Chip8Rewind::apply(const uint8_t* data, Chip8State& state)
+{
+    auto* dst = reinterpret_cast<uint8_t*>(&state);
+    applySparse(data, dst + MEMORY_OFFSET);
+    applyRle(data, dst + GFX_OFFSET, GFX_SIZE);
+    applySparse(data, dst + REST_OFFSET);
+}
+
+void Chip8Rewind::record(const Chip8State& state)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_Scratch.clear();
+    uint32_t deltaSize = 0;
+    if (not m_Entries.empty())
+    {
+        encode(state, m_Last, m_Scratch);
+        deltaSize = static_cast<uint32_t>(m_Scratch.size());
+    }
+    uint32_t keySize = 0;
+    if (m_Entries.empty() or (m_SinceKeyframe + 1 >= KEYFRAME_PERIOD))
+    {
+        encode(ZERO_STATE, state, m_Scratch);
+        keySize = static_cast<uint32_t>(m_Scratch.size()) - deltaSize;
+        m_SinceKeyframe = 0;
+    }
+    else
+    {
+        m_SinceKeyframe++;
+    }
+    // byte for byte, padding included, the deltas are taken over the raw bytes
+    std::memcpy(&m_Last, &state, sizeof(Chip8State));
+
+    store();
+    m_Entries.back().deltaSize = deltaSize;
+    m_Entries.back().keySize = keySize;
+
+    m_Stats.frames++;
+    m_Stats.bytes += m_Scratch.size();
+    m_Stats.recordTime += std::chrono::steady_clock::now() - start;
+}
+
+// Copies the scratch buffer to the head of the ring, dropping the oldest
+// entries it overwrites
+void Chip8Rewind::store(void)
+{
+    std::size_t size = m_Scratch.size();
+    if (m_Head + size > m_Ring.size())
+    {
+        // the tail is left unused, the entries in it are the oldest ones
+        while ((not m_Entries.empty()) and (m_Entries.front().offset >= m_Head))
+        {
+            m_Entries.pop_front();
+        }
+        m_Head = 0;
+    }
+    while ((not m_Entries.empty()) and (m_Entries.front().offset >= m_Head) and
+            (m_Entries.front().offset < m_Head + size))
+    {
+        m_Entries.pop_front();
+    }
+    std::memcpy(m_Ring.data() + m_Head, m_Scratch.data(), size);
+    m_Entries.push_back({m_Head, 0, 0});
+    m_Head += size;
+}
+
+unsigned Chip8Rewind::rewind(unsigned frames, Chip8State& state)
+{
+    if (getDepth() < frames)
+    {
+        frames = static_cast<unsigned>(getDepth());
+    }
+    if (0 == frames)
+    {
+        return 0;
+    }
+
+    // start from the newest keyframe at or past the target, if there is one
+    // closer than the newest entry
+    std::size_t target = m_Entries.size() - 1 - frames;
+    std::size_t idx = m_Entries.size() - 1;
+    for (std::size_t i = target; i < idx; i++)
+    {
+        if (0 != m_Entries[i].keySize)
+        {
+            std::memcpy(&m_Last, &ZERO_STATE, sizeof(Chip8State));
+            apply(m_Ring.data() + m_Entries[i].offset + m_Entries[i].deltaSize, m_Last);
+            idx = i;
+            break;
+        }
+    }
+    for (; idx > target; idx--)
+    {
+        apply(m_Ring.data() + m_Entries[idx].offset, m_Last);
+    }
+
+    m_Entries.erase(m_Entries.begin() + static_cast<std::ptrdiff_t>(target + 1), m_Entries.end());
+    m_Head = m_Entries.back().offset + m_Entries.back().deltaSize + m_Entries.back().keySize;
+    m_SinceKeyframe = 0;
+    for (auto entry = m_Entries.rbegin(); (m_Entries.rend() != entry) and (0 == entry->keySize); entry++)
+    {
+        m_SinceKeyframe++;
+    }
+    std::memcpy(&state, &m_Last, sizeof(Chip8State));
+    return frames;
+}
+
+// The oldest entry has nothing left to step back to
+std::size_t Chip8Rewind::getDepth(void) const
+{
+    return m_Entries.empty() ? 0 : m_Entries.size() - 1;
+}
+
+std::size_t Chip8Rewind::getUsedBytes(void) const
+{
+    std::size_t used = 0;
+    for (const auto& entry : m_Entries)
+    {
+        used += entry.deltaSize + entry.keySize;
+    }
+    return used;
+}
+
+const Chip8Rewind::Stats& Chip8Rewind::getStats(void) const
+{
+    return m_Stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "Chip8State.hxx"
+
+// Rewind history, one Chip8State per recorded frame in a fixed memory budget.
+// Every frame is stored as the XOR delta back to the frame before it:
+// memory and the registers as sparse runs of changed bytes, the screen run
+// length encoded. Every KEYFRAME_PERIOD frames the full state is stored as
+// well, so a long jump back decodes at most KEYFRAME_PERIOD deltas. When the
+// budget is used up the oldest frames are dropped.
+class Chip8Rewind
+{
+    public:
+        static constexpr std::size_t DEFAULT_BUDGET_B = 4 << 20;
+        static constexpr std::size_t MIN_BUDGET_B = 64 << 10;
+        static constexpr unsigned KEYFRAME_PERIOD = 300;
+
+        typedef struct
+        {
+            uint64_t frames;
+            uint64_t bytes;
+            std::chrono::duration<double> recordTime;
+        } Stats;
+
+        explicit Chip8Rewind(std::size_t budget_B = DEFAULT_BUDGET_B);
+        void clear(void);
+        void record(const Chip8State& state);
+        // Steps up to `frames` frames back and stores the state there, returns
+        // the number of frames stepped, 0 at the oldest frame held
+        unsigned rewind(unsigned frames, Chip8State& state);
+        // frames that can still be stepped back
+        std::size_t getDepth(void) const;
+        std::size_t getUsedBytes(void) const;
+        // totals of every record() call
+        const Stats& getStats(void) const;
+
+    private:
+        typedef struct
+        {
+            std::size_t offset;
+            uint32_t deltaSize;
+            uint32_t keySize;
+        } Entry;
+
+        static void encode(const Chip8State& from, const Chip8State& to, std::vector<uint8_t>& out);
+        static void apply(const uint8_t* data, Chip8State& state);
+        void store(void);
+
+        std::vector<uint8_t> m_Ring;
+        std::size_t m_Head;
+        // oldest first
+        std::deque<Entry> m_Entries;
+        std::vector<uint8_t> m_Scratch;
+        // state of the newest entry
+        Chip8State m_Last;
+        unsigned m_SinceKeyframe;
+        Stats m_Stats;
+};
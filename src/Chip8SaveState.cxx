@@ -0,0 +1,126 @@
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fmt/core.h>
+
+#include "Chip8SaveState.hxx"
+
+void Chip8SaveState::save(const Chip8& cpu, const std::string& path)
+{
+    FileHeader header{};
+    header.magic = MAGIC;
+    header.version = FORMAT_VERSION;
+    header.minReaderVersion = 1;
+    header.headerSize = sizeof(FileHeader);
+    header.stateSize = sizeof(Chip8State);
+    header.romHash = cpu.getRomHash();
+    header.quirks = QUIRKS;
+
+    Chip8State state;
+    cpu.saveState(state);
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&state), sizeof(state));
+        if (not file.good())
+        {
+            throw std::runtime_error(fmt::format("Unable to write save state {}", tmpPath));
+        }
+    }
+    if (0 != std::rename(tmpPath.c_str(), path.c_str()))
+    {
+        throw std::runtime_error(fmt::format("Unable to rename {} to {}: {}", 
+                    tmpPath, path, std::strerror(errno)));
+    }
+}
+
+void Chip8SaveState::load(Chip8& cpu, const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(fmt::format("Unable to open save state {}: {}", path, std::strerror(errno)));
+    }
+    struct stat st;
+    if ((0 != fstat(fd, &st)) or (static_cast<std::size_t>(st.st_size) < sizeof(FileHeader)))
+    {
+        close(fd);
+        throw std::runtime_error(fmt::format("{} is not a save state", path));
+    }
+    auto mapSize = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (MAP_FAILED == map)
+    {
+        throw std::runtime_error(fmt::format("Unable to map save state {}: {}", path, std::strerror(errno)));
+    }
+
+    const auto* header = static_cast<const FileHeader*>(map);
+    std::string err;
+    if (MAGIC != header->magic)
+    {
+        err = fmt::format("{} is not a save state", path);
+    }
+    else if (header->minReaderVersion > FORMAT_VERSION)
+    {
+        err = fmt::format("{} needs a version {} reader, this is version {}", 
+                path, header->minReaderVersion, FORMAT_VERSION);
+    }
+    else if ((header->headerSize < sizeof(FileHeader)) or (0 != header->headerSize % alignof(Chip8State)) or
+            (static_cast<std::size_t>(header->headerSize) + header->stateSize > mapSize))
+    {
+        err = fmt::format("{} is truncated or corrupt", path);
+    }
+    else if (cpu.getRomHash() != header->romHash)
+    {
+        err = fmt::format("{} belongs to ROM 0x{:016X}, the loaded ROM is 0x{:016X}", 
+                path, header->romHash, cpu.getRomHash());
+    }
+    else if (QUIRKS != header->quirks)
+    {
+        err = fmt::format("{} was saved with quirks 0x{:X}, this build runs 0x{:X}", 
+                path, header->quirks, QUIRKS);
+    }
+
+    // the core indexes the stack with sp and memory with pc and i unchecked,
+    // a corrupt or hand-made file must not get that far
+    Chip8State extended{};
+    const Chip8State* state = &extended;
+    if (err.empty())
+    {
+        const auto* mapped = static_cast<const uint8_t*>(map) + header->headerSize;
+        if (header->stateSize >= sizeof(Chip8State))
+        {
+            state = reinterpret_cast<const Chip8State*>(mapped);
+        }
+        else
+        {
+            std::memcpy(&extended, mapped, header->stateSize);
+        }
+        if (((state->sp >= Chip8State::STACK_SIZE) and (Chip8::SP_RESET_VALUE != state->sp)) or
+                (state->pc > Chip8::PROGRAM_END_ADDR) or (state->i > Chip8::PROGRAM_END_ADDR))
+        {
+            err = fmt::format("{} holds an invalid state: PC = 0x{:X}, I = 0x{:X}, SP = 0x{:X}", 
+                    path, state->pc, state->i, state->sp);
+        }
+    }
+    if (not err.empty())
+    {
+        munmap(map, mapSize);
+        throw std::runtime_error(err);
+    }
+
+    cpu.loadState(*state);
+    munmap(map, mapSize);
+}
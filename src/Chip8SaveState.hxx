@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <type_traits>
+
+#include "Chip8.hxx"
+
+// Save state files: a 64 byte header followed by the raw Chip8State, in the
+// byte order of the machine that wrote it. Loading maps the file and hands
+// the state to Chip8::loadState() in place, nothing is parsed.
+//
+// Compatibility rules:
+// - fields are only ever appended to FileHeader and Chip8State, headerSize
+//   and stateSize say where the state starts and how long it is. A shorter
+//   state from an older writer is zero-extended, the tail of a longer one
+//   from a newer writer is ignored
+// - a change older readers cannot ignore raises minReaderVersion, readers
+//   refuse files asking for a newer version than theirs
+class Chip8SaveState
+{
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+        static constexpr std::array<char, 8> MAGIC = {'C', 'H', '8', 'S', 'T', 'A', 'T', 'E'};
+        // Chip8 has no configurable quirks yet, bit flags go here once it
+        // does. A state only loads into a Chip8 with the same quirks.
+        static constexpr uint32_t QUIRKS = 0;
+
+        typedef struct FileHeader
+        {
+            std::array<char, 8> magic;
+            // of the writer
+            uint32_t version;
+            // oldest reader that understands the file
+            uint32_t minReaderVersion;
+            // offset of the state
+            uint32_t headerSize;
+            uint32_t stateSize;
+            // Chip8::getRomHash() of the program the state belongs to
+            uint64_t romHash;
+            uint32_t quirks;
+            uint32_t reserved0;
+            uint8_t reserved1[24];
+        } FileHeader;
+        static_assert(sizeof(FileHeader) == 64);
+        static_assert(std::is_trivially_copyable_v<FileHeader>);
+
+        // Written to a temporary file first, so a crash never leaves a torn
+        // state behind
+        static void save(const Chip8& cpu, const std::string& path);
+        // Throws when the file is not a save state, is too new, belongs to
+        // another ROM or holds a PC, I or SP out of range
+        static void load(Chip8& cpu, const std::string& path);
+};
@@ -0,0 +1,378 @@
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <fmt/core.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "Chip8Search.hxx"
+
+namespace
+{
+    // parents a worker takes at a time, each of them is BRANCH_CNT steps
+    constexpr std::size_t CHUNK_SIZE = 8;
+
+    uint16_t parseNumber(const std::string& text, const std::string& spec, unsigned max)
+    {
+        std::size_t end = 0;
+        unsigned long value = 0;
+        try
+        {
+            value = std::stoul(text, &end, 0);
+        }
+        catch (const std::exception&)
+        {
+            end = 0;
+        }
+        if (text.empty() or (text.size() != end) or (value > max))
+        {
+            throw std::runtime_error(fmt::format("Bad goal '{}', '{}' is not a number up to {}", spec, text, max));
+        }
+        return static_cast<uint16_t>(value);
+    }
+}
+
+Chip8Search::Goal Chip8Search::goalFromString(const std::string& spec)
+{
+    Goal goal{Goal::Kind::FAULT, 0, "", 0, 0, 0};
+    if ("fault" == spec)
+    {
+        return goal;
+    }
+    if (0 == spec.rfind("mem:", 0))
+    {
+        auto expr = spec.substr(4);
+        // != before the single character operators, it contains one of them
+        for (const std::string op : {"!=", "=", "<", ">"})
+        {
+            auto pos = expr.find(op);
+            if (std::string::npos != pos)
+            {
+                goal.kind = Goal::Kind::MEMORY;
+                goal.addr = parseNumber(expr.substr(0, pos), spec, Chip8::PROGRAM_END_ADDR);
+                goal.op = op;
+                goal.value = static_cast<uint8_t>(parseNumber(expr.substr(pos + op.size()), spec, 0xFF));
+                return goal;
+            }
+        }
+    }
+    if (0 == spec.rfind("pixel:", 0))
+    {
+        std::istringstream ss(spec.substr(6));
+        std::string col;
+        std::string row;
+        if (std::getline(ss, col, ',') and std::getline(ss, row))
+        {
+            goal.kind = Goal::Kind::PIXEL;
+            goal.col = static_cast<uint8_t>(parseNumber(col, spec, Chip8::GFX_COLS - 1));
+            goal.row = static_cast<uint8_t>(parseNumber(row, spec, Chip8::GFX_ROWS - 1));
+            return goal;
+        }
+    }
+    throw std::runtime_error(fmt::format(
+                "Bad goal '{}', expected mem:<addr><=|!=|<|><value>, pixel:<col>,<row> or fault", spec));
+}
+
+Chip8Search::Params Chip8Search::defaultParams(void)
+{
+    return Params{DEFAULT_CLK_HZ, DEFAULT_MAX_DEPTH, DEFAULT_MAX_STATES, DEFAULT_FRAMES_PER_STEP,
+        std::max(1U, std::thread::hardware_concurrency()), 0, 0};
+}
+
+Chip8Search::Chip8Search(const Params& params, std::shared_ptr<spdlog::logger> logger) :
+    m_Params{params},
+    m_CyclesPerFrame{std::max(1U, params.clkHz/Chip8::TIMER_HZ)}
+{
+    if ((0 == params.threads) or (0 == params.framesPerStep))
+    {
+        throw std::runtime_error("The search needs at least one thread and one frame per step");
+    }
+    if (nullptr == logger)
+    {
+        m_LoggerName = fmt::format("{}-Chip8Search", getpid());
+        logger = spdlog::get(m_LoggerName);
+        if (nullptr == logger)
+        {
+            logger = spdlog::stderr_color_mt(m_LoggerName);
+        }
+    }
+    m_Logger = logger;
+}
+
+bool Chip8Search::VisitedSet::insert(uint64_t hash)
+{
+    auto& shard = m_Shards[hash % SHARD_CNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.hashes.insert(hash).second;
+}
+
+std::size_t Chip8Search::VisitedSet::size(void) const
+{
+    std::size_t size = 0;
+    for (const auto& shard : m_Shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.hashes.size();
+    }
+    return size;
+}
+
+// An estimate, a node holds the hash and the next pointer, plus the bucket
+// array
+std::size_t Chip8Search::VisitedSet::getBytes(void) const
+{
+    std::size_t bytes = sizeof(VisitedSet);
+    for (const auto& shard : m_Shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.hashes.size()*(sizeof(uint64_t) + sizeof(void*)) +
+            shard.hashes.bucket_count()*sizeof(void*);
+    }
+    return bytes;
+}
+
+bool Chip8Search::isGoal(const Goal& goal, const Chip8& cpu)
+{
+    switch (goal.kind)
+    {
+        case Goal::Kind::MEMORY:
+        {
+            uint8_t value = cpu.readByte(goal.addr);
+            if ("=" == goal.op)
+            {
+                return value == goal.value;
+            }
+            if ("!=" == goal.op)
+            {
+                return value != goal.value;
+            }
+            if ("<" == goal.op)
+            {
+                return value < goal.value;
+            }
+            return value > goal.value;
+        }
+        case Goal::Kind::PIXEL:
+            return cpu.getGfx()(goal.row, goal.col);
+        case Goal::Kind::FAULT:
+            // only a step that throws reaches it
+            return false;
+    }
+    return false;
+}
+
+// The same frames as the headless runner and movies
+void Chip8Search::runStep(Chip8& cpu, uint16_t keys) const
+{
+    for (unsigned frame = 0; frame < m_Params.framesPerStep; frame++)
+    {
+        cpu.setKeys(keys);
+        cpu.emulateFrame(m_CyclesPerFrame);
+    }
+}
+
+// Pages are shared between forks, each of them is counted once
+void Chip8Search::collectPages(const std::vector<Node>& nodes, std::unordered_set<const void*>& pages)
+{
+    for (const auto& node : nodes)
+    {
+        for (const auto& page : node.fork.pages)
+        {
+            pages.insert(page.get());
+        }
+    }
+}
+
+Chip8Search::Result Chip8Search::run(const std::string& romPath, const Goal& goal)
+{
+    auto start = std::chrono::steady_clock::now();
+    Result result{};
+
+    Chip8 root(m_Logger);
+    root.loadRom(romPath);
+    root.setRandomSeed(m_Params.seed, m_Params.stream);
+    result.romHash = root.getRomHash();
+
+    VisitedSet visited;
+    visited.insert(root.stateHash());
+    if (isGoal(goal, root))
+    {
+        result.isFound = true;
+        result.finalStateHash = root.stateHash();
+        result.states = 1;
+        result.elapsed = std::chrono::steady_clock::now() - start;
+        return result;
+    }
+
+    std::vector<Node> frontier(1);
+    root.fork(frontier[0].fork);
+    // trace[d] holds how every state d + 1 steps from reset was reached
+    std::vector<std::vector<Step>> trace;
+
+    std::vector<std::unique_ptr<Chip8>> executors;
+    for (unsigned t = 0; t < m_Params.threads; t++)
+    {
+        executors.push_back(std::make_unique<Chip8>(m_Logger));
+    }
+
+    std::atomic<bool> isFound{false};
+    std::atomic<uint64_t> states{1};
+    std::atomic<uint64_t> expanded{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> faults{0};
+    std::mutex foundMutex;
+    Step found{0, 0};
+
+    auto setFound = [&](uint32_t parent, uint16_t keys, uint64_t hash)
+    {
+        std::lock_guard<std::mutex> lock(foundMutex);
+        if (not isFound)
+        {
+            found = Step{parent, keys};
+            result.finalStateHash = hash;
+            isFound = true;
+        }
+    };
+
+    unsigned depth = 0;
+    for (; (depth < m_Params.maxDepth) and not frontier.empty() and (states < m_Params.maxStates); depth++)
+    {
+        std::vector<std::vector<Node>> children(m_Params.threads);
+        std::atomic<std::size_t> next{0};
+
+        auto worker = [&](unsigned t)
+        {
+            Chip8& cpu = *executors[t];
+            while (not isFound)
+            {
+                std::size_t begin = next.fetch_add(CHUNK_SIZE);
+                std::size_t end = std::min(begin + CHUNK_SIZE, frontier.size());
+                for (std::size_t i = begin; (i < end) and not isFound and (states < m_Params.maxStates); i++)
+                {
+                    auto parent = static_cast<uint32_t>(i);
+                    for (unsigned branch = 0; (branch < BRANCH_CNT) and not isFound; branch++)
+                    {
+                        auto keys = static_cast<uint16_t>((0 == branch) ? 0 : (1U << (branch - 1)));
+                        // only the pages the previous step wrote are copied back
+                        cpu.loadFork(frontier[i].fork);
+                        try
+                        {
+                            runStep(cpu, keys);
+                        }
+                        catch (const Chip8Fault&)
+                        {
+                            faults++;
+                            if (Goal::Kind::FAULT == goal.kind)
+                            {
+                                setFound(parent, keys, 0);
+                            }
+                            continue;
+                        }
+                        uint64_t hash = cpu.stateHash();
+                        if (not visited.insert(hash))
+                        {
+                            duplicates++;
+                            continue;
+                        }
+                        states++;
+                        if (isGoal(goal, cpu))
+                        {
+                            setFound(parent, keys, hash);
+                            break;
+                        }
+                        children[t].push_back(Node{Chip8Fork{}, parent, keys});
+                        cpu.fork(children[t].back().fork);
+                    }
+                    expanded++;
+                }
+                if (end >= frontier.size())
+                {
+                    break;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < m_Params.threads; t++)
+        {
+            threads.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        std::vector<Node> level;
+        for (auto& nodes : children)
+        {
+            std::move(nodes.begin(), nodes.end(), std::back_inserter(level));
+        }
+        std::unordered_set<const void*> pages;
+        collectPages(frontier, pages);
+        collectPages(level, pages);
+        result.peakBytes = std::max(result.peakBytes, pages.size()*Chip8Fork::PAGE_SIZE_B +
+                (frontier.size() + level.size())*sizeof(Node) + visited.getBytes());
+        m_Logger->info("Depth {}: {} states, {} new", depth + 1, states.load(), level.size());
+
+        if (isFound)
+        {
+            break;
+        }
+        std::vector<Step> steps;
+        steps.reserve(level.size());
+        for (const auto& node : level)
+        {
+            steps.push_back(Step{node.parent, node.keys});
+        }
+        trace.push_back(std::move(steps));
+        frontier = std::move(level);
+    }
+
+    if (isFound)
+    {
+        // the goal is one step past the frontier, walk the trace back to reset
+        std::vector<uint16_t> keys{found.keys};
+        uint32_t idx = found.parent;
+        for (std::size_t d = trace.size(); d > 0; d--)
+        {
+            keys.push_back(trace[d - 1][idx].keys);
+            idx = trace[d - 1][idx].parent;
+        }
+        for (auto step = keys.rbegin(); keys.rend() != step; step++)
+        {
+            result.frameKeys.insert(result.frameKeys.end(), m_Params.framesPerStep, *step);
+        }
+        result.isFound = true;
+        result.depth = static_cast<unsigned>(keys.size());
+    }
+    else
+    {
+        result.depth = depth;
+    }
+    result.expanded = expanded;
+    result.states = states;
+    result.duplicates = duplicates;
+    result.faults = faults;
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+Chip8Movie Chip8Search::toMovie(const Result& result) const
+{
+    if (not result.isFound)
+    {
+        throw std::runtime_error("The search did not reach its goal, there is no movie to write");
+    }
+    Chip8Movie movie(result.romHash, m_Params.seed, m_Params.stream, m_Params.clkHz);
+    for (auto keys : result.frameKeys)
+    {
+        movie.record(keys);
+    }
+    movie.setFinalStateHash(result.finalStateHash);
+    return movie;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <spdlog/logger.h>
+
+#include "Chip8.hxx"
+#include "Chip8Fork.hxx"
+#include "Chip8Movie.hxx"
+
+// Breadth-first search over inputs. Every state is expanded into one child
+// per key plus one with no key held, each child runs framesPerStep frames
+// (keys set, clkHz/60 cycles, one timer tick, as in the headless runner).
+// Children are deduplicated by Chip8::stateHash() in a visited set shared by
+// all threads, and kept as copy-on-write forks, so a level of the search
+// costs the pages its states wrote. The search stops at the first state
+// that satisfies the goal, at maxDepth steps or at maxStates states.
+class Chip8Search
+{
+    public:
+        static constexpr unsigned DEFAULT_CLK_HZ = 540;
+        static constexpr unsigned DEFAULT_MAX_DEPTH = 60;
+        static constexpr uint64_t DEFAULT_MAX_STATES = 1000000;
+        // a key is held for this many frames, most ROMs poll once a frame
+        static constexpr unsigned DEFAULT_FRAMES_PER_STEP = 1;
+        // no key and each of the 16 keys
+        static constexpr unsigned BRANCH_CNT = Chip8::KEYBOARD_SIZE + 1;
+
+        // mem:<addr><op><value> with op one of = != < >, e.g. mem:0x3A0>9
+        // pixel:<col>,<row> the pixel is on
+        // fault the ROM faults, e.g. overflows the stack
+        typedef struct
+        {
+            enum class Kind
+            {
+                MEMORY,
+                PIXEL,
+                FAULT
+            };
+            Kind kind;
+            uint16_t addr;
+            std::string op;
+            uint8_t value;
+            uint8_t col;
+            uint8_t row;
+        } Goal;
+
+        typedef struct
+        {
+            unsigned clkHz;
+            unsigned maxDepth;
+            uint64_t maxStates;
+            unsigned framesPerStep;
+            unsigned threads;
+            uint64_t seed;
+            uint64_t stream;
+        } Params;
+
+        typedef struct
+        {
+            bool isFound;
+            uint64_t romHash;
+            // keys held in every frame from reset to the goal
+            std::vector<uint16_t> frameKeys;
+            uint64_t finalStateHash;
+            unsigned depth;
+            uint64_t expanded;
+            uint64_t states;
+            uint64_t duplicates;
+            uint64_t faults;
+            std::chrono::duration<double> elapsed;
+            // fork pages and visited set, not counting the executors
+            std::size_t peakBytes;
+        } Result;
+
+        static Goal goalFromString(const std::string& spec);
+        static Params defaultParams(void);
+
+        Chip8Search(const Params& params, std::shared_ptr<spdlog::logger> logger = nullptr);
+        // The ROM runs from reset with the seed and stream in params
+        Result run(const std::string& romPath, const Goal& goal);
+        // The keys that reach the goal, CppChip8-headless --movie replays them
+        Chip8Movie toMovie(const Result& result) const;
+
+    private:
+        typedef struct
+        {
+            Chip8Fork fork;
+            // index in the previous level
+            uint32_t parent;
+            uint16_t keys;
+        } Node;
+
+        // keys of every state of a level, the forks are dropped once the next
+        // level is built
+        typedef struct
+        {
+            uint32_t parent;
+            uint16_t keys;
+        } Step;
+
+        // The visited set is split into shards with a lock each, so threads
+        // inserting different hashes rarely wait for each other
+        class VisitedSet
+        {
+            public:
+                static constexpr std::size_t SHARD_CNT = 64;
+                bool insert(uint64_t hash);
+                std::size_t size(void) const;
+                std::size_t getBytes(void) const;
+
+            private:
+                // a cache line each, so locking one shard does not slow down
+                // the threads using its neighbours
+                typedef struct alignas(64)
+                {
+                    mutable std::mutex mutex;
+                    std::unordered_set<uint64_t> hashes;
+                } Shard;
+                std::array<Shard, SHARD_CNT> m_Shards;
+        };
+
+        static bool isGoal(const Goal& goal, const Chip8& cpu);
+        void runStep(Chip8& cpu, uint16_t keys) const;
+        static void collectPages(const std::vector<Node>& nodes, std::unordered_set<const void*>& pages);
+
+        Params m_Params;
+        unsigned m_CyclesPerFrame;
+        // https://github.com/gabime/spdlog/wiki/2.-Creating-loggers
+        std::string m_LoggerName;
+        std::shared_ptr<spdlog::logger> m_Logger;
+};
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "Chip8StackSampler.hxx"
+
+Chip8StackSampler::Chip8StackSampler(unsigned periodCycles) :
+    m_Period{periodCycles},
+    m_Countdown{periodCycles},
+    m_SampleCnt{0}
+{
+    if (0 == m_Period)
+    {
+        throw std::runtime_error("Sampling period must be at least 1 cycle");
+    }
+}
+
+void Chip8StackSampler::sample(const Chip8& cpu)
+{
+    cpu.getCallStack(m_ReturnAddrs);
+
+    // the CALL that pushed a return address sits right before it
+    m_Frames.clear();
+    for (auto returnAddr : m_ReturnAddrs)
+    {
+        uint16_t callOp = cpu.readOp(static_cast<uint16_t>(returnAddr - Chip8::INSTRUCTION_SIZE_B));
+        m_Frames.push_back(callOp & 0x0FFF);
+    }
+
+    auto stack = m_Stacks.find(m_Frames);
+    if (m_Stacks.end() == stack)
+    {
+        m_Stacks.emplace(m_Frames, 1);
+    }
+    else
+    {
+        stack->second++;
+    }
+    m_SampleCnt++;
+}
+
+uint64_t Chip8StackSampler::getSampleCount(void) const
+{
+    return m_SampleCnt;
+}
+
+void Chip8StackSampler::writeFolded(std::ostream& os) const
+{
+    for (const auto& [frames, cnt] : m_Stacks)
+    {
+        std::string line = "rom";
+        for (auto frame : frames)
+        {
+            line += fmt::format(";sub_0x{:03X}", frame);
+        }
+        os << line << " " << cnt << "\n";
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <ostream>
+
+#include "Chip8.hxx"
+
+// Samples the guest call stack every `period` cycles and aggregates the
+// samples as folded stacks (https://github.com/brendangregg/FlameGraph):
+//
+//   rom;sub_0x2A0;sub_0x300 1234
+//
+// Frames are named after the subroutine address, taken from the CALL that
+// pushed each return address. Drivers call tick() once per emulated cycle.
+class Chip8StackSampler
+{
+    public:
+        static constexpr unsigned DEFAULT_PERIOD_CYCLES = 97;
+
+        // a prime default period keeps samples from locking onto loops
+        explicit Chip8StackSampler(unsigned periodCycles = DEFAULT_PERIOD_CYCLES);
+
+        inline void tick(const Chip8& cpu)
+        {
+            if (0 == --m_Countdown)
+            {
+                m_Countdown = m_Period;
+                sample(cpu);
+            }
+        }
+
+        void sample(const Chip8& cpu);
+        uint64_t getSampleCount(void) const;
+        void writeFolded(std::ostream& os) const;
+
+    private:
+        unsigned m_Period;
+        unsigned m_Countdown;
+        uint64_t m_SampleCnt;
+        std::vector<uint16_t> m_ReturnAddrs;
+        std::vector<uint16_t> m_Frames;
+        std::map<std::vector<uint16_t>, uint64_t> m_Stacks;
+};
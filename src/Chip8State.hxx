@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <bitset>
+#include <type_traits>
+
+#include "Bitset2D.txx"
+
+// Every bit of architectural state of a Chip8 in one fixed-size block with no
+// pointers, so a snapshot or a restore is a single memcpy. Decoded operands
+// and per-cycle flags are not part of it, the next fetch recreates them.
+struct Chip8State
+{
+    static constexpr std::size_t MEMORY_SIZE_B = 4096;
+    static constexpr std::size_t REGISTER_CNT = 16;
+    static constexpr std::size_t STACK_SIZE = 16;
+    static constexpr std::size_t KEYBOARD_SIZE = 16;
+    static constexpr std::size_t GFX_ROWS = 32;
+    static constexpr std::size_t GFX_COLS = 64;
+
+    std::array<uint8_t, MEMORY_SIZE_B> memory;
+    Bitset2D<GFX_ROWS, GFX_COLS> gfx;
+    uint64_t cycleCnt;
+    std::array<uint16_t, STACK_SIZE> stack;
+    std::array<uint8_t, REGISTER_CNT> v;
+    uint16_t pc;
+    uint16_t i;
+    // index of the top of the stack, 0xFF when empty
+    uint8_t sp;
+    // decremented once per 60Hz frame by Chip8::decrementTimers()
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+    uint8_t rnd;
+    std::bitset<KEYBOARD_SIZE> keyboard;
+    std::bitset<KEYBOARD_SIZE> previousKeyboard;
+    // inside Fx0A, waiting for a key to be released
+    bool isKeyWait;
+    // PCG32 generator of CXkk, rngInc is odd once seeded and selects the
+    // stream. Zero in states saved before it was added.
+    uint64_t rngState;
+    uint64_t rngInc;
+};
+
+static_assert(std::is_trivially_copyable_v<Chip8State>, "Chip8State has to be memcpy-able");
+static_assert(std::is_standard_layout_v<Chip8State>, "Chip8State has to have a fixed layout");
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fmt/core.h>
+
+#include "Chip8TraceReader.hxx"
+#include "Chip8Disassembler.hxx"
+
+Chip8TraceReader::Chip8TraceReader(const std::string& path) :
+    m_MapSize{0},
+    m_Header{nullptr},
+    m_Records{nullptr}
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(fmt::format("Unable to open trace {}: {}", path, std::strerror(errno)));
+    }
+    struct stat st;
+    if ((0 != fstat(fd, &st)) or (static_cast<std::size_t>(st.st_size) < sizeof(Chip8TraceRecorder::FileHeader)))
+    {
+        close(fd);
+        throw std::runtime_error(fmt::format("{} is not a trace file", path));
+    }
+    m_MapSize = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, m_MapSize, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (MAP_FAILED == map)
+    {
+        throw std::runtime_error(fmt::format("Unable to map trace {}: {}", path, std::strerror(errno)));
+    }
+    m_Header = static_cast<const Chip8TraceRecorder::FileHeader*>(map);
+    m_Records = reinterpret_cast<const Record*>(static_cast<const uint8_t*>(map) + sizeof(Chip8TraceRecorder::FileHeader));
+
+    std::size_t expectedSize = sizeof(Chip8TraceRecorder::FileHeader) + 
+        static_cast<std::size_t>(m_Header->capacity)*sizeof(Record);
+    if ((Chip8TraceRecorder::MAGIC != m_Header->magic) or 
+        (Chip8TraceRecorder::FORMAT_VERSION != m_Header->version) or
+        (sizeof(Record) != m_Header->recordSize) or
+        (expectedSize != m_MapSize))
+    {
+        munmap(map, m_MapSize);
+        throw std::runtime_error(fmt::format(
+                    "{} is not a version {} trace file", path, Chip8TraceRecorder::FORMAT_VERSION));
+    }
+}
+
+Chip8TraceReader::~Chip8TraceReader()
+{
+    munmap(const_cast<Chip8TraceRecorder::FileHeader*>(m_Header), m_MapSize);
+}
+
+uint64_t Chip8TraceReader::size(void) const
+{
+    return std::min<uint64_t>(m_Header->recordCnt, m_Header->capacity);
+}
+
+uint64_t Chip8TraceReader::getRecordCount(void) const
+{
+    return m_Header->recordCnt;
+}
+
+const Chip8TraceReader::Record& Chip8TraceReader::at(uint64_t idx) const
+{
+    if (idx >= size())
+    {
+        throw std::out_of_range(fmt::format("Trace record {} out of range [0, {})", idx, size()));
+    }
+    uint64_t oldest = m_Header->recordCnt - size();
+    return m_Records[(oldest + idx) % m_Header->capacity];
+}
+
+std::string Chip8TraceReader::format(const Record& r)
+{
+    std::string line = fmt::format("{:>10} 0x{:03X}: 0x{:04X} {:<18} I=0x{:03X} SP={} DT={} ST={}",
+            r.cycle, r.pc, r.op, Chip8Disassembler::disassemble(r.op), r.i, r.sp, r.dt, r.st);
+    for (uint8_t i = 0; i < Chip8::REGISTER_CNT; i++)
+    {
+        if (r.vMask & (1U << i))
+        {
+            line += fmt::format(" V{:X}=0x{:02X}", i, r.v[i]);
+        }
+    }
+    if (r.memLen > 0)
+    {
+        line += fmt::format(" [0x{:03X}]=", r.memAddr);
+        for (uint8_t i = 0; i < r.memLen; i++)
+        {
+            line += fmt::format("{}{:02X}", (0 == i) ? "" : " ", r.mem[i]);
+        }
+    }
+    return line;
+}
+
+bool Chip8TraceReader::isSame(const Record& a, const Record& b)
+{
+    if ((a.cycle != b.cycle) or (a.pc != b.pc) or (a.op != b.op) or (a.i != b.i) or 
+        (a.vMask != b.vMask) or (a.sp != b.sp) or (a.dt != b.dt) or (a.st != b.st) or
+        (a.memLen != b.memLen) or ((a.memLen > 0) and (a.memAddr != b.memAddr)))
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < Chip8::REGISTER_CNT; i++)
+    {
+        if ((a.vMask & (1U << i)) and (a.v[i] != b.v[i]))
+        {
+            return false;
+        }
+    }
+    return 0 == std::memcmp(a.mem, b.mem, a.memLen);
+}
+
+void Chip8TraceReader::dump(std::ostream& os, uint64_t skip, uint64_t count) const
+{
+    os << fmt::format("# {} records, {} written\n", size(), getRecordCount());
+    // skip + count overflows with the default count of UINT64_MAX
+    uint64_t end = skip + std::min(count, size() - std::min(skip, size()));
+    for (uint64_t idx = skip; idx < end; idx++)
+    {
+        os << format(at(idx)) << "\n";
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <ostream>
+
+#include "Chip8TraceRecorder.hxx"
+
+// Read only view of a trace written by Chip8TraceRecorder, oldest record
+// first
+class Chip8TraceReader
+{
+    public:
+        typedef Chip8TraceRecorder::Record Record;
+
+        Chip8TraceReader(const std::string& path);
+        ~Chip8TraceReader();
+        Chip8TraceReader(const Chip8TraceReader&) = delete;
+        Chip8TraceReader& operator=(const Chip8TraceReader&) = delete;
+
+        uint64_t size(void) const;
+        // records written in total, larger than size() once the ring wrapped
+        uint64_t getRecordCount(void) const;
+        const Record& at(uint64_t idx) const;
+
+        // e.g. "      1234 0x2A4: 0x8124 ADD V1, V2       I=0x300 SP=0 DT=0 ST=0 V1=0x05 VF=0x00"
+        static std::string format(const Record& r);
+        // Same executed instruction with the same effects, reserved bytes and
+        // the values of unchanged registers are ignored
+        static bool isSame(const Record& a, const Record& b);
+        // A header line, then up to count records starting at record skip
+        void dump(std::ostream& os, uint64_t skip, uint64_t count) const;
+
+    private:
+        std::size_t m_MapSize;
+        const Chip8TraceRecorder::FileHeader* m_Header;
+        const Record* m_Records;
+};
@@ -0,0 +1,104 @@
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <fmt/core.h>
+
+#include "Chip8TraceRecorder.hxx"
+
+Chip8TraceRecorder::Chip8TraceRecorder(const std::string& path, uint32_t capacity) :
+    m_Fd{-1},
+    m_MapSize{sizeof(FileHeader) + static_cast<std::size_t>(capacity)*sizeof(Record)},
+    m_Header{nullptr},
+    m_Records{nullptr}
+{
+    if (0 == capacity)
+    {
+        throw std::runtime_error("Trace capacity must be at least 1 record");
+    }
+
+    m_Fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_Fd < 0)
+    {
+        throw std::runtime_error(fmt::format("Unable to open trace {}: {}", path, std::strerror(errno)));
+    }
+    if (0 != ftruncate(m_Fd, static_cast<off_t>(m_MapSize)))
+    {
+        int err = errno;
+        close(m_Fd);
+        throw std::runtime_error(fmt::format("Unable to size trace {}: {}", path, std::strerror(err)));
+    }
+    void* map = mmap(nullptr, m_MapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_Fd, 0);
+    if (MAP_FAILED == map)
+    {
+        int err = errno;
+        close(m_Fd);
+        throw std::runtime_error(fmt::format("Unable to map trace {}: {}", path, std::strerror(err)));
+    }
+
+    m_Header = static_cast<FileHeader*>(map);
+    m_Records = reinterpret_cast<Record*>(static_cast<uint8_t*>(map) + sizeof(FileHeader));
+    std::memset(m_Header, 0, sizeof(FileHeader));
+    m_Header->magic = MAGIC;
+    m_Header->version = FORMAT_VERSION;
+    m_Header->recordSize = sizeof(Record);
+    m_Header->capacity = capacity;
+    m_V.fill(0);
+}
+
+Chip8TraceRecorder::~Chip8TraceRecorder()
+{
+    // the kernel writes the shared mapping back, even if we crash later on
+    munmap(m_Header, m_MapSize);
+    close(m_Fd);
+}
+
+void Chip8TraceRecorder::emulateCycle(Chip8& cpu)
+{
+    Record& r = m_Records[m_Header->recordCnt % m_Header->capacity];
+    r.cycle = cpu.getCycleCount();
+    r.pc = cpu.getPC();
+    r.op = cpu.readOp(r.pc);
+    r.memAddr = cpu.getI();
+    r.memLen = 0;
+    if (0xF033 == (r.op & 0xF0FF))
+    {
+        r.memLen = 3;
+    }
+    else if (0xF055 == (r.op & 0xF0FF))
+    {
+        r.memLen = static_cast<uint8_t>(((r.op >> 8) & 0x0F) + 1);
+    }
+
+    cpu.emulateCycle();
+
+    r.i = cpu.getI();
+    r.sp = cpu.getSP();
+    r.dt = cpu.getDelayTimer();
+    r.st = cpu.getSoundTimer();
+    r.vMask = 0;
+    for (uint8_t i = 0; i < Chip8::REGISTER_CNT; i++)
+    {
+        uint8_t v = cpu.getV(i);
+        r.v[i] = v;
+        if (v != m_V[i])
+        {
+            r.vMask = static_cast<uint16_t>(r.vMask | (1U << i));
+            m_V[i] = v;
+        }
+    }
+    for (uint8_t i = 0; i < r.memLen; i++)
+    {
+        r.mem[i] = cpu.readByte(static_cast<uint16_t>(r.memAddr + i));
+    }
+    m_Header->recordCnt++;
+}
+
+uint64_t Chip8TraceRecorder::getRecordCount(void) const
+{
+    return m_Header->recordCnt;
+}
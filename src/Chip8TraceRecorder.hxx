@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <type_traits>
+
+#include "Chip8.hxx"
+
+// Appends one fixed size record per executed instruction to a memory mapped
+// ring file. Only what the instruction changed is stored, so tracing costs a
+// few stores per cycle instead of formatting the whole machine state.
+// Chip8TraceReader and the tracedump tool decode the file.
+class Chip8TraceRecorder
+{
+    public:
+        static constexpr uint32_t DEFAULT_CAPACITY = 1U << 20; // 64 MiB of records
+        static constexpr uint32_t FORMAT_VERSION = 1;
+        static constexpr std::array<char, 8> MAGIC = {'C', 'H', '8', 'T', 'R', 'A', 'C', 'E'};
+
+        // 64 bytes, one cache line
+        typedef struct Record
+        {
+            uint64_t cycle;
+            uint16_t pc;
+            uint16_t op;
+            uint16_t i;
+            // bit n set when Vn changed, v[n] is only valid then
+            uint16_t vMask;
+            uint8_t v[16];
+            // bytes written by Fx33/Fx55, starting at memAddr
+            uint16_t memAddr;
+            uint8_t memLen;
+            uint8_t sp;
+            uint8_t mem[16];
+            uint8_t dt;
+            uint8_t st;
+            uint8_t reserved[10];
+        } Record;
+        static_assert(sizeof(Record) == 64);
+        static_assert(std::is_trivially_copyable_v<Record>);
+
+        typedef struct FileHeader
+        {
+            std::array<char, 8> magic;
+            uint32_t version;
+            uint32_t recordSize;
+            uint32_t capacity;
+            uint32_t reserved0;
+            // total records ever written, the ring holds the last `capacity`
+            uint64_t recordCnt;
+            uint8_t reserved1[32];
+        } FileHeader;
+        static_assert(sizeof(FileHeader) == sizeof(Record));
+
+        Chip8TraceRecorder(const std::string& path, uint32_t capacity = DEFAULT_CAPACITY);
+        ~Chip8TraceRecorder();
+        Chip8TraceRecorder(const Chip8TraceRecorder&) = delete;
+        Chip8TraceRecorder& operator=(const Chip8TraceRecorder&) = delete;
+
+        // Executes one cycle on cpu and records it
+        void emulateCycle(Chip8& cpu);
+        uint64_t getRecordCount(void) const;
+
+    private:
+        int m_Fd;
+        std::size_t m_MapSize;
+        FileHeader* m_Header;
+        Record* m_Records;
+        std::array<uint8_t, Chip8::REGISTER_CNT> m_V;
+};
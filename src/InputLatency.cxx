@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include "InputLatency.hxx"
+
+const std::vector<double> InputLatency::BUCKETS_S = 
+{
+    0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0
+};
+
+InputLatency::InputLatency(unsigned cyclesPerFrame) :
+    m_ToRead{m_Metrics.addHistogram("chip8_input_to_read_seconds", 
+            "Time from a key event arriving in SDL to the first guest read of the key", BUCKETS_S)},
+    m_ToDrw{m_Metrics.addHistogram("chip8_input_read_to_drw_seconds", 
+            "Time from the first guest read of a key to the next DRW changing pixels", BUCKETS_S)},
+    m_ToPresent{m_Metrics.addHistogram("chip8_input_drw_to_present_seconds", 
+            "Time from that DRW to SDL_RenderPresent returning", BUCKETS_S)},
+    m_Total{m_Metrics.addHistogram("chip8_input_to_photon_seconds", 
+            "Time from a key event arriving in SDL to SDL_RenderPresent returning", BUCKETS_S)},
+    m_Abandoned{m_Metrics.addCounter("chip8_input_abandoned_total", 
+            "Key presses replaced by a newer one before a DRW answered them")},
+    m_NoDrw{m_Metrics.addCounter("chip8_input_no_drw_total", 
+            "Key presses read by the guest without a DRW changing pixels in the frames after")},
+    m_Count{m_Metrics.addCounter("chip8_input_presses_total", "Key presses followed to the screen")},
+    m_MaxDrwCycles{static_cast<uint64_t>(MAX_DRW_FRAMES)*std::max(1U, cyclesPerFrame)},
+    m_Stage{Stage::IDLE},
+    m_Key{0},
+    m_DrwWaitCycles{0},
+    m_Arrival{},
+    m_Read{},
+    m_Drw{}
+{
+}
+
+void InputLatency::onKeyDown(Chip8& cpu, uint8_t key, clock::time_point arrival)
+{
+    if ((Stage::WAIT_READ == m_Stage) or (Stage::WAIT_DRW == m_Stage))
+    {
+        m_Abandoned.add();
+    }
+    else if (Stage::IDLE != m_Stage)
+    {
+        return;
+    }
+    // reads from before the press do not count
+    cpu.clearKeyReads();
+    m_Stage = Stage::WAIT_READ;
+    m_Key = key;
+    m_Arrival = arrival;
+}
+
+void InputLatency::advance(Chip8& cpu)
+{
+    switch (m_Stage)
+    {
+        case Stage::WAIT_READ:
+            // reads of other keys are of no interest, forget them
+            if (cpu.getKeyReads() & (1U << m_Key))
+            {
+                m_Read = clock::now();
+                m_DrwWaitCycles = 0;
+                m_Stage = Stage::WAIT_DRW;
+            }
+            cpu.clearKeyReads();
+            break;
+
+        case Stage::WAIT_DRW:
+            if (cpu.isDrw() and not cpu.getUpdatedPixelsState().empty())
+            {
+                m_Drw = clock::now();
+                m_Stage = Stage::WAIT_PRESENT;
+            }
+            // an unrelated DRW much later would pass for the answer
+            else if (++m_DrwWaitCycles >= m_MaxDrwCycles)
+            {
+                m_NoDrw.add();
+                m_Stage = Stage::IDLE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void InputLatency::onPresent(void)
+{
+    if (Stage::WAIT_PRESENT != m_Stage)
+    {
+        return;
+    }
+    auto now = clock::now();
+    m_ToRead.observe(std::chrono::duration<double>(m_Read - m_Arrival).count());
+    m_ToDrw.observe(std::chrono::duration<double>(m_Drw - m_Read).count());
+    m_ToPresent.observe(std::chrono::duration<double>(now - m_Drw).count());
+    m_Total.observe(std::chrono::duration<double>(now - m_Arrival).count());
+    m_Count.add();
+    m_Stage = Stage::IDLE;
+}
+
+uint64_t InputLatency::getCount(void) const
+{
+    return m_Count.get();
+}
+
+void InputLatency::write(std::ostream& os) const
+{
+    m_Metrics.write(os);
+}
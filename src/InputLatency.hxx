@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include "Chip8.hxx"
+#include "Metrics.hxx"
+
+// Follows a key press from the SDL event to the photons: the event arriving
+// in SDL's queue, the first guest read of that key (Ex9E, ExA1, Fx0A), the
+// next DRW that changes pixels and SDL_RenderPresent returning. One press is
+// followed at a time, every stage and the total feed histograms of the
+// session. A read that no DRW follows within MAX_DRW_FRAMES is dropped. Only
+// the emulation thread calls it.
+class InputLatency
+{
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        // 100us to 5s
+        static const std::vector<double> BUCKETS_S;
+        // a DRW later than this is not taken as the answer to the read
+        static constexpr unsigned MAX_DRW_FRAMES = 60;
+
+        explicit InputLatency(unsigned cyclesPerFrame);
+        // A press that did not reach a DRW yet is replaced by a newer one, a
+        // press already drawn keeps being followed
+        void onKeyDown(Chip8& cpu, uint8_t key, clock::time_point arrival);
+
+        // after every cycle
+        inline void onCycle(Chip8& cpu)
+        {
+            if (Stage::IDLE != m_Stage)
+            {
+                advance(cpu);
+            }
+        }
+
+        // after SDL_RenderPresent returned
+        void onPresent(void);
+        uint64_t getCount(void) const;
+        // Prometheus text format
+        void write(std::ostream& os) const;
+
+    private:
+        enum class Stage
+        {
+            IDLE,
+            WAIT_READ,
+            WAIT_DRW,
+            WAIT_PRESENT
+        };
+
+        void advance(Chip8& cpu);
+
+        Metrics m_Metrics;
+        Metrics::Histogram& m_ToRead;
+        Metrics::Histogram& m_ToDrw;
+        Metrics::Histogram& m_ToPresent;
+        Metrics::Histogram& m_Total;
+        Metrics::Counter& m_Abandoned;
+        Metrics::Counter& m_NoDrw;
+        Metrics::Counter& m_Count;
+        const uint64_t m_MaxDrwCycles;
+
+        Stage m_Stage;
+        uint8_t m_Key;
+        // cycles since the read, in WAIT_DRW
+        uint64_t m_DrwWaitCycles;
+        clock::time_point m_Arrival;
+        clock::time_point m_Read;
+        clock::time_point m_Drw;
+};
@@ -0,0 +1,110 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "InputScript.hxx"
+
+InputScript::InputScript(const std::string& filename)
+{
+    load(filename);
+}
+
+void InputScript::load(const std::string& filename)
+{
+    std::ifstream script(filename);
+    if (not script.good())
+    {
+        throw std::runtime_error("Unable to open " + filename);
+    }
+
+    m_Events.clear();
+    m_Next = 0;
+
+    std::string line;
+    unsigned lineNbr = 0;
+    while (std::getline(script, line))
+    {
+        lineNbr++;
+        auto first = line.find_first_not_of(" \t\r");
+        if ((std::string::npos == first) or ('#' == line[first]))
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        uint64_t frame;
+        std::string key, state;
+        if (not (fields >> frame >> key >> state))
+        {
+            throw std::runtime_error(fmt::format(
+                        "{}:{}: expected '<frame> <key> <down|up>', got '{}'",
+                        filename, lineNbr, line));
+        }
+
+        unsigned long keyNbr = 0;
+        std::size_t keyLen = 0;
+        try
+        {
+            keyNbr = std::stoul(key, &keyLen, 16);
+        }
+        catch (const std::logic_error&)
+        {
+        }
+        if (keyLen != key.size())
+        {
+            throw std::runtime_error(fmt::format(
+                        "{}:{}: key must be a hex digit, got '{}'",
+                        filename, lineNbr, key));
+        }
+        if (keyNbr >= Chip8::KEYBOARD_SIZE)
+        {
+            throw std::runtime_error(fmt::format(
+                        "{}:{}: key 0x{} is outside [0, 0x{:X}]",
+                        filename, lineNbr, key, Chip8::KEYBOARD_SIZE-1));
+        }
+
+        if (("down" != state) and ("up" != state))
+        {
+            throw std::runtime_error(fmt::format(
+                        "{}:{}: key state must be 'down' or 'up', got '{}'",
+                        filename, lineNbr, state));
+        }
+
+        m_Events.push_back({
+                .frame = frame,
+                .key = static_cast<uint8_t>(keyNbr),
+                .isPressed = ("down" == state)
+                });
+    }
+
+    // keep the order of events within a frame as written
+    std::stable_sort(m_Events.begin(), m_Events.end(),
+            [](const InputEvent& a, const InputEvent& b) { return a.frame < b.frame; });
+}
+
+void InputScript::apply(uint64_t frame, Chip8& cpu)
+{
+    while ((m_Next < m_Events.size()) and (m_Events[m_Next].frame <= frame))
+    {
+        cpu.setKey(m_Events[m_Next].key, m_Events[m_Next].isPressed);
+        m_Next++;
+    }
+}
+
+void InputScript::rewind(void)
+{
+    m_Next = 0;
+}
+
+const std::vector<InputScript::InputEvent>& InputScript::getEvents(void) const
+{
+    return m_Events;
+}
+
+bool InputScript::isDone(void) const
+{
+    return m_Next >= m_Events.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Chip8.hxx"
+
+// Scripted key presses for runs without a keyboard. One event per line:
+//
+//   <frame> <key> <down|up>
+//
+// where frame is a decimal frame number, key is a hex digit 0-F. Lines
+// starting with '#' and blank lines are ignored. Events are applied at the
+// start of the frame they name.
+class InputScript
+{
+    public:
+        typedef struct
+        {
+            uint64_t frame;
+            uint8_t key;
+            bool isPressed;
+        } InputEvent;
+
+        InputScript() = default;
+        explicit InputScript(const std::string& filename);
+        void load(const std::string& filename);
+        void apply(uint64_t frame, Chip8& cpu);
+        void rewind(void);
+        const std::vector<InputEvent>& getEvents(void) const;
+        bool isDone(void) const;
+
+    private:
+        std::vector<InputEvent> m_Events;
+        std::size_t m_Next = 0;
+};
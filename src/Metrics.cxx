@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "Metrics.hxx"
+
+const std::vector<double> Metrics::SECONDS_BUCKETS = 
+{
+    0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0
+};
+
+uint64_t Metrics::Counter::get(void) const
+{
+    return m_Value.load(std::memory_order_relaxed);
+}
+
+double Metrics::Gauge::get(void) const
+{
+    return m_Value.load(std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Histogram(const std::vector<double>& bounds) :
+    m_Bounds{bounds},
+    m_Counts{std::make_unique<std::atomic<uint64_t>[]>(bounds.size())}
+{
+    if (not std::is_sorted(m_Bounds.begin(), m_Bounds.end()))
+    {
+        throw std::runtime_error("Histogram bucket bounds must be ascending");
+    }
+    for (std::size_t i = 0; i < m_Bounds.size(); i++)
+    {
+        m_Counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::observe(double value)
+{
+    // per bucket counts, made cumulative when written
+    auto bucket = std::lower_bound(m_Bounds.begin(), m_Bounds.end(), value);
+    if (m_Bounds.end() != bucket)
+    {
+        m_Counts[static_cast<std::size_t>(bucket - m_Bounds.begin())].fetch_add(1, std::memory_order_relaxed);
+    }
+    m_Count.fetch_add(1, std::memory_order_relaxed);
+    m_Sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::Histogram::write(std::ostream& os, const std::string& name) const
+{
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < m_Bounds.size(); i++)
+    {
+        cumulative += m_Counts[i].load(std::memory_order_relaxed);
+        os << fmt::format("{}_bucket{{le=\"{}\"}} {}\n", name, m_Bounds[i], cumulative);
+    }
+    // read after the buckets so +Inf never is below the last bucket
+    uint64_t count = std::max(cumulative, m_Count.load(std::memory_order_relaxed));
+    os << fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, count);
+    os << fmt::format("{}_sum {}\n", name, m_Sum.load(std::memory_order_relaxed));
+    os << fmt::format("{}_count {}\n", name, count);
+}
+
+Metrics::Counter& Metrics::addCounter(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.push_back({name, help, std::make_unique<Counter>(), nullptr, nullptr});
+    return *m_Entries.back().counter;
+}
+
+Metrics::Gauge& Metrics::addGauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.push_back({name, help, nullptr, std::make_unique<Gauge>(), nullptr});
+    return *m_Entries.back().gauge;
+}
+
+Metrics::Histogram& Metrics::addHistogram(const std::string& name, const std::string& help,
+        const std::vector<double>& bounds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.push_back({name, help, nullptr, nullptr, std::make_unique<Histogram>(bounds)});
+    return *m_Entries.back().histogram;
+}
+
+// https://prometheus.io/docs/instrumenting/exposition_formats/
+void Metrics::write(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const auto& entry : m_Entries)
+    {
+        os << fmt::format("# HELP {} {}\n", entry.name, entry.help);
+        if (entry.counter)
+        {
+            os << fmt::format("# TYPE {} counter\n{} {}\n", entry.name, entry.name, entry.counter->get());
+        }
+        else if (entry.gauge)
+        {
+            os << fmt::format("# TYPE {} gauge\n{} {}\n", entry.name, entry.name, entry.gauge->get());
+        }
+        else
+        {
+            os << fmt::format("# TYPE {} histogram\n", entry.name);
+            entry.histogram->write(os, entry.name);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Counters, gauges and histograms updated with relaxed atomics, so any thread
+// can update them without locks while another one writes them out in the
+// Prometheus text exposition format. Metrics are registered up front and
+// live as long as the registry.
+class Metrics
+{
+    public:
+        class Counter
+        {
+            public:
+                inline void add(uint64_t n = 1)
+                {
+                    m_Value.fetch_add(n, std::memory_order_relaxed);
+                }
+                uint64_t get(void) const;
+
+            private:
+                std::atomic<uint64_t> m_Value{0};
+        };
+
+        class Gauge
+        {
+            public:
+                inline void set(double value)
+                {
+                    m_Value.store(value, std::memory_order_relaxed);
+                }
+                double get(void) const;
+
+            private:
+                std::atomic<double> m_Value{0.0};
+        };
+
+        class Histogram
+        {
+            public:
+                // upper bounds of the buckets, ascending, +Inf is implicit
+                explicit Histogram(const std::vector<double>& bounds);
+                void observe(double value);
+                void write(std::ostream& os, const std::string& name) const;
+
+            private:
+                std::vector<double> m_Bounds;
+                std::unique_ptr<std::atomic<uint64_t>[]> m_Counts;
+                std::atomic<uint64_t> m_Count{0};
+                std::atomic<double> m_Sum{0.0};
+        };
+
+        // 1ms to 5s
+        static const std::vector<double> SECONDS_BUCKETS;
+
+        Counter& addCounter(const std::string& name, const std::string& help);
+        Gauge& addGauge(const std::string& name, const std::string& help);
+        Histogram& addHistogram(const std::string& name, const std::string& help,
+                const std::vector<double>& bounds = SECONDS_BUCKETS);
+        void write(std::ostream& os) const;
+
+    private:
+        typedef struct
+        {
+            std::string name;
+            std::string help;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+        } Entry;
+
+        mutable std::mutex m_Mutex;
+        std::vector<Entry> m_Entries;
+};
@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <fmt/core.h>
+
+#include "MetricsExporter.hxx"
+
+MetricsExporter::MetricsExporter(const Metrics& metrics, const std::string& target,
+        std::chrono::milliseconds period) :
+    m_Metrics{metrics},
+    m_Path{target},
+    m_IsSocket{0 == target.rfind(SOCKET_PREFIX, 0)},
+    m_Period{period},
+    m_ListenFd{-1},
+    m_IsStopping{false}
+{
+    if (m_Period.count() <= 0)
+    {
+        throw std::runtime_error("The metrics export period must be at least 1ms");
+    }
+    if (not m_IsSocket)
+    {
+        writeFile();
+        m_Thread = std::thread(&MetricsExporter::runFile, this);
+        return;
+    }
+
+    m_Path = target.substr(std::strlen(SOCKET_PREFIX));
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (m_Path.empty() or (m_Path.size() >= sizeof(addr.sun_path)))
+    {
+        throw std::runtime_error(fmt::format("Invalid metrics socket path: {}", m_Path));
+    }
+    std::memcpy(addr.sun_path, m_Path.c_str(), m_Path.size());
+
+    m_ListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // a socket left behind by an earlier run would make bind() fail
+    unlink(m_Path.c_str());
+    if ((m_ListenFd < 0) or 
+        (0 != bind(m_ListenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) or
+        (0 != listen(m_ListenFd, 4)))
+    {
+        std::string err = fmt::format("Unable to listen on {}: {}", m_Path, std::strerror(errno));
+        if (m_ListenFd >= 0)
+        {
+            close(m_ListenFd);
+        }
+        throw std::runtime_error(err);
+    }
+    m_Thread = std::thread(&MetricsExporter::runSocket, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    m_IsStopping = true;
+    m_Thread.join();
+    if (m_IsSocket)
+    {
+        close(m_ListenFd);
+        unlink(m_Path.c_str());
+    }
+    else
+    {
+        writeFile();
+    }
+}
+
+void MetricsExporter::flush(void) const
+{
+    if (not m_IsSocket)
+    {
+        writeFile();
+    }
+}
+
+// Readers never see a half written file
+void MetricsExporter::writeFile(void) const
+{
+    std::string tmpPath = m_Path + ".tmp";
+    {
+        std::ofstream out(tmpPath);
+        m_Metrics.write(out);
+    }
+    std::rename(tmpPath.c_str(), m_Path.c_str());
+}
+
+void MetricsExporter::runFile(void)
+{
+    auto next = std::chrono::steady_clock::now() + m_Period;
+    while (not m_IsStopping)
+    {
+        // wake up often enough to stop promptly with long periods
+        std::this_thread::sleep_for(std::min(m_Period, std::chrono::milliseconds(100)));
+        if (std::chrono::steady_clock::now() >= next)
+        {
+            writeFile();
+            next += m_Period;
+        }
+    }
+}
+
+void MetricsExporter::runSocket(void)
+{
+    while (not m_IsStopping)
+    {
+        pollfd pfd{m_ListenFd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+        {
+            continue;
+        }
+        int fd = accept4(m_ListenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // the request itself doesn't matter, every path gets the metrics
+        char request[1024];
+        pollfd rfd{fd, POLLIN, 0};
+        if (poll(&rfd, 1, 100) > 0)
+        {
+            [[maybe_unused]] auto cnt = read(fd, request, sizeof(request));
+        }
+
+        std::ostringstream body;
+        m_Metrics.write(body);
+        std::string response = fmt::format(
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: {}\r\n"
+                "\r\n{}", body.str().size(), body.str());
+        std::size_t sent = 0;
+        while (sent < response.size())
+        {
+            auto cnt = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (cnt <= 0)
+            {
+                break;
+            }
+            sent += static_cast<std::size_t>(cnt);
+        }
+        close(fd);
+    }
+}
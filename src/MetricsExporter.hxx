@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Metrics.hxx"
+
+// Publishes a registry from a background thread. A plain path is rewritten
+// every period (atomically, through a rename), "unix:<path>" listens on a Unix
+// socket and answers every connection with a minimal HTTP response, e.g.
+//
+//   curl --unix-socket /tmp/chip8.sock http://localhost/metrics
+class MetricsExporter
+{
+    public:
+        static constexpr unsigned DEFAULT_PERIOD_mS = 1000;
+
+        MetricsExporter(const Metrics& metrics, const std::string& target, 
+                std::chrono::milliseconds period = std::chrono::milliseconds(DEFAULT_PERIOD_mS));
+        ~MetricsExporter();
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        // Writes the file once more, no-op for a socket
+        void flush(void) const;
+
+    private:
+        static constexpr const char* SOCKET_PREFIX = "unix:";
+
+        void writeFile(void) const;
+        void runFile(void);
+        void runSocket(void);
+
+        const Metrics& m_Metrics;
+        std::string m_Path;
+        bool m_IsSocket;
+        std::chrono::milliseconds m_Period;
+        int m_ListenFd;
+        std::atomic<bool> m_IsStopping;
+        std::thread m_Thread;
+};
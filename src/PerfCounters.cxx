@@ -0,0 +1,177 @@
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <fmt/core.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "PerfCounters.hxx"
+
+const std::array<const char*, PerfCounters::COUNTER_CNT> PerfCounters::COUNTER_NAMES = 
+{
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "l1d_read_misses",
+    "l1i_read_misses",
+};
+
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    // user space only, this is what perf_event_paranoid=2 still allows
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // needed to scale the count if the kernel had to multiplex counters
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static constexpr uint64_t cacheReadMiss(uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+    m_Fds.fill(-1);
+    m_Values.fill(0);
+#ifdef __linux__
+    const std::array<std::pair<uint32_t, uint64_t>, COUNTER_CNT> events = 
+    {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1I)},
+    }};
+    for (std::size_t i = 0; i < COUNTER_CNT; i++)
+    {
+        m_Fds[i] = openCounter(events[i].first, events[i].second);
+        if (m_Fds[i] < 0)
+        {
+            m_Errors[i] = std::strerror(errno);
+        }
+    }
+#else
+    m_Errors.fill("perf events are only supported on Linux");
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (auto fd : m_Fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void PerfCounters::start(void)
+{
+#ifdef __linux__
+    for (auto fd : m_Fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+// Adds whatever was counted since start() to the totals
+void PerfCounters::stop(void)
+{
+#ifdef __linux__
+    for (auto fd : m_Fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (std::size_t i = 0; i < COUNTER_CNT; i++)
+    {
+        // value, time enabled, time running
+        uint64_t data[3] = {0, 0, 0};
+        if ((m_Fds[i] < 0) or (sizeof(data) != read(m_Fds[i], data, sizeof(data))))
+        {
+            continue;
+        }
+
+        if ((0 != data[2]) and (data[2] < data[1]))
+        {
+            data[0] = static_cast<uint64_t>(
+                    static_cast<double>(data[0])*static_cast<double>(data[1])/static_cast<double>(data[2]));
+        }
+        m_Values[i] += data[0];
+    }
+#endif
+}
+
+void PerfCounters::reset(void)
+{
+    m_Values.fill(0);
+}
+
+bool PerfCounters::isAvailable(Counter counter) const
+{
+    return m_Fds[counter] >= 0;
+}
+
+bool PerfCounters::isAnyAvailable(void) const
+{
+    return std::any_of(m_Fds.begin(), m_Fds.end(), [](int fd) { return fd >= 0; });
+}
+
+const std::string& PerfCounters::getError(Counter counter) const
+{
+    return m_Errors[counter];
+}
+
+uint64_t PerfCounters::get(Counter counter) const
+{
+    return m_Values[counter];
+}
+
+std::string PerfCounters::report(uint64_t emulatedInstructions, uint64_t frames) const
+{
+    std::string result;
+    for (std::size_t i = 0; i < COUNTER_CNT; i++)
+    {
+        auto counter = static_cast<Counter>(i);
+        if (not isAvailable(counter))
+        {
+            result += fmt::format("perf_{}: n/a ({})\n", COUNTER_NAMES[i], m_Errors[i]);
+            continue;
+        }
+
+        auto value = static_cast<double>(m_Values[i]);
+        result += fmt::format("perf_{}: {} per_instruction: {:.3f} per_frame: {:.1f}\n",
+                COUNTER_NAMES[i], m_Values[i],
+                value/static_cast<double>(std::max<uint64_t>(1, emulatedInstructions)),
+                value/static_cast<double>(std::max<uint64_t>(1, frames)));
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <string>
+
+// Hardware counters read through Linux perf_event_open around a region of
+// code. Each counter is opened on its own so a missing one (L1i misses are
+// often not exposed in VMs) or a restrictive perf_event_paranoid only
+// disables that counter. Counters that cannot be opened read as unavailable,
+// so on other platforms the class is a no-op.
+class PerfCounters
+{
+    public:
+        enum Counter
+        {
+            CYCLES,
+            INSTRUCTIONS,
+            BRANCH_MISSES,
+            L1D_READ_MISSES,
+            L1I_READ_MISSES,
+            COUNTER_CNT
+        };
+        static const std::array<const char*, COUNTER_CNT> COUNTER_NAMES;
+
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        void start(void);
+        void stop(void);
+        void reset(void);
+        bool isAvailable(Counter counter) const;
+        bool isAnyAvailable(void) const;
+        const std::string& getError(Counter counter) const;
+        uint64_t get(Counter counter) const;
+        // one "name: total, per instruction, per frame" line per counter
+        std::string report(uint64_t emulatedInstructions, uint64_t frames) const;
+
+    private:
+        std::array<int, COUNTER_CNT> m_Fds;
+        std::array<std::string, COUNTER_CNT> m_Errors;
+        std::array<uint64_t, COUNTER_CNT> m_Values;
+};
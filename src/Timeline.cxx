@@ -0,0 +1,67 @@
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "Timeline.hxx"
+
+Timeline::Buffer::Buffer(const std::string& threadName, uint32_t tid, uint32_t capacity) :
+    m_ThreadName{threadName},
+    m_Tid{tid},
+    m_Events(capacity),
+    m_EventCnt{0},
+    m_DroppedCnt{0}
+{
+}
+
+// Appends the thread name and the complete ("X") events recorded so far,
+// timestamps are in microseconds since origin_ns
+void Timeline::Buffer::write(std::ostream& os, bool& isFirst, uint64_t origin_ns) const
+{
+    os << fmt::format("{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},"
+            "\"args\":{{\"name\":\"{}\"}}}}", isFirst ? "" : ",", getpid(), m_Tid, m_ThreadName);
+    isFirst = false;
+
+    uint32_t cnt = m_EventCnt.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        const Event& e = m_Events[i];
+        os << fmt::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},"
+                "\"ts\":{:.3f},\"dur\":{:.3f}}}", e.name, getpid(), m_Tid, 
+                static_cast<double>(e.start_ns - origin_ns)/1e3, static_cast<double>(e.end_ns - e.start_ns)/1e3);
+    }
+}
+
+uint64_t Timeline::Buffer::getDroppedCount(void) const
+{
+    return m_DroppedCnt.load(std::memory_order_relaxed);
+}
+
+Timeline::Timeline(uint32_t eventsPerThread) :
+    m_EventsPerThread{eventsPerThread},
+    m_Start_ns{now()}
+{
+}
+
+Timeline::Buffer* Timeline::addThread(const std::string& threadName)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Buffers.push_back(std::make_unique<Buffer>(
+                threadName, static_cast<uint32_t>(m_Buffers.size() + 1), m_EventsPerThread));
+    return m_Buffers.back().get();
+}
+
+// Threads may still be recording, only their events published so far are
+// written
+void Timeline::write(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    uint64_t droppedCnt = 0;
+    bool isFirst = true;
+    os << "{\"traceEvents\":[";
+    for (const auto& buffer : m_Buffers)
+    {
+        buffer->write(os, isFirst, m_Start_ns);
+        droppedCnt += buffer->getDroppedCount();
+    }
+    os << fmt::format("\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{{\"dropped_events\":{}}}}}\n", droppedCnt);
+}
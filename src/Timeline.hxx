@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Records scoped phase timings and writes them as Chrome trace events, open
+// the file in chrome://tracing or https://ui.perfetto.dev. Every thread owns a
+// preallocated buffer that only it writes to, so recording takes no locks and
+// never allocates. Buffers that fill up drop further events.
+class Timeline
+{
+    public:
+        static constexpr uint32_t DEFAULT_EVENTS_PER_THREAD = 1U << 20;
+
+        typedef struct
+        {
+            // string literals only, names are not copied
+            const char* name;
+            uint64_t start_ns;
+            uint64_t end_ns;
+        } Event;
+
+        class Buffer
+        {
+            public:
+                Buffer(const std::string& threadName, uint32_t tid, uint32_t capacity);
+
+                inline void add(const char* name, uint64_t start_ns, uint64_t end_ns)
+                {
+                    uint32_t cnt = m_EventCnt.load(std::memory_order_relaxed);
+                    if (cnt == m_Events.size())
+                    {
+                        m_DroppedCnt.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    m_Events[cnt] = {name, start_ns, end_ns};
+                    // publish the event to write() running on another thread
+                    m_EventCnt.store(cnt + 1, std::memory_order_release);
+                }
+
+                void write(std::ostream& os, bool& isFirst, uint64_t origin_ns) const;
+                uint64_t getDroppedCount(void) const;
+
+            private:
+                std::string m_ThreadName;
+                uint32_t m_Tid;
+                std::vector<Event> m_Events;
+                std::atomic<uint32_t> m_EventCnt;
+                std::atomic<uint64_t> m_DroppedCnt;
+        };
+
+        // Times its own lifetime, does nothing for a null buffer so call
+        // sites don't need to check whether the timeline is enabled
+        class Scope
+        {
+            public:
+                Scope(Buffer* buffer, const char* name) :
+                    m_Buffer{buffer},
+                    m_Name{name},
+                    m_Start_ns{(nullptr == buffer) ? 0 : now()}
+                {
+                }
+
+                ~Scope()
+                {
+                    if (nullptr != m_Buffer)
+                    {
+                        m_Buffer->add(m_Name, m_Start_ns, now());
+                    }
+                }
+
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+
+            private:
+                Buffer* m_Buffer;
+                const char* m_Name;
+                uint64_t m_Start_ns;
+        };
+
+        Timeline(uint32_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+        // The returned buffer lives as long as the timeline, call once per thread
+        Buffer* addThread(const std::string& threadName);
+        void write(std::ostream& os) const;
+
+        static inline uint64_t now(void)
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+    private:
+        uint32_t m_EventsPerThread;
+        uint64_t m_Start_ns;
+        mutable std::mutex m_Mutex;
+        std::vector<std::unique_ptr<Buffer>> m_Buffers;
+};
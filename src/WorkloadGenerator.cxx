@@ -0,0 +1,323 @@
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <fmt/core.h>
+
+#include "WorkloadGenerator.hxx"
+
+namespace
+{
+    // Tiny assembler, addresses are absolute
+    class Assembler
+    {
+        public:
+            uint16_t here(void) const
+            {
+                return static_cast<uint16_t>(Chip8::PROGRAM_START_ADDR + m_Rom.size());
+            }
+
+            void emit(uint16_t op, const std::string& mnemonic = "")
+            {
+                m_Rom.push_back(static_cast<uint8_t>(op >> 8));
+                m_Rom.push_back(static_cast<uint8_t>(op & 0xFF));
+                if (m_IsCounting and not mnemonic.empty())
+                {
+                    m_Mix[mnemonic]++;
+                }
+            }
+
+            void patch(uint16_t addr, uint16_t op)
+            {
+                auto offset = addr - Chip8::PROGRAM_START_ADDR;
+                m_Rom[offset] = static_cast<uint8_t>(op >> 8);
+                m_Rom[offset + 1] = static_cast<uint8_t>(op & 0xFF);
+            }
+
+            void count(bool isCounting)
+            {
+                m_IsCounting = isCounting;
+            }
+
+            std::vector<uint8_t> m_Rom;
+            std::map<std::string, unsigned> m_Mix;
+
+        private:
+            bool m_IsCounting = false;
+    };
+
+    uint16_t op_xkk(uint16_t id, uint8_t x, uint8_t kk)
+    {
+        return static_cast<uint16_t>((id << 12) | (x << 8) | kk);
+    }
+
+    uint16_t op_xyn(uint16_t id, uint8_t x, uint8_t y, uint8_t n)
+    {
+        return static_cast<uint16_t>((id << 12) | (x << 8) | (y << 4) | n);
+    }
+
+    uint16_t op_nnn(uint16_t id, uint16_t nnn)
+    {
+        return static_cast<uint16_t>((id << 12) | (nnn & 0x0FFF));
+    }
+}
+
+WorkloadGenerator::Workload WorkloadGenerator::generate(const Params& params)
+{
+    if (0 == params.unroll)
+    {
+        throw std::runtime_error("Workload unroll must be at least 1");
+    }
+    if (((Kind::DRW == params.kind) or (Kind::CALL == params.kind)) and 
+            ((params.param < 1) or (params.param > 15)))
+    {
+        throw std::runtime_error(fmt::format(
+                    "Workload param for {} must be in [1, 15], got {}", 
+                    kindToString(params.kind), params.param));
+    }
+
+    std::mt19937 rng(params.seed);
+    Assembler a;
+    // subroutines are placed after the halt, remember where to patch the calls
+    std::vector<uint16_t> callSites;
+
+    // prologue
+    const uint16_t counter = static_cast<uint16_t>(0x10000 - params.iterations);
+    a.emit(op_xkk(0x6, 0xD, static_cast<uint8_t>(counter >> 8)));
+    a.emit(op_xkk(0x6, 0xE, static_cast<uint8_t>(counter & 0xFF)));
+    for (uint8_t reg = 0; reg < 8; reg++)
+    {
+        a.emit(op_xkk(0x6, reg, static_cast<uint8_t>(rng() & 0xFF)));
+    }
+    if (Kind::DRW == params.kind)
+    {
+        a.emit(op_nnn(0xA, static_cast<uint16_t>(Chip8::FONT_SPRITES_START_ADDR + 5*(rng() % 16))));
+    }
+    if (Kind::SMC == params.kind)
+    {
+        // high byte of the rewritten instruction, LD V2, kk
+        a.emit(op_xkk(0x6, 0x0, 0x62));
+    }
+
+    const uint16_t loopAddr = a.here();
+    a.count(true);
+    for (uint8_t copy = 0; copy < params.unroll; copy++)
+    {
+        switch (params.kind)
+        {
+            case Kind::ALU:
+                a.emit(op_xyn(0x8, 0, 1, 0x4), "ADD Vx, Vy");
+                a.emit(op_xyn(0x8, 2, 3, 0x5), "SUB Vx, Vy");
+                a.emit(op_xyn(0x8, 4, 5, 0x1), "OR Vx, Vy");
+                a.emit(op_xyn(0x8, 6, 7, 0x3), "XOR Vx, Vy");
+                a.emit(op_xyn(0x8, 1, 2, 0x2), "AND Vx, Vy");
+                a.emit(op_xyn(0x8, 3, 0, 0x6), "SHR Vx");
+                a.emit(op_xyn(0x8, 5, 6, 0x7), "SUBN Vx, Vy");
+                a.emit(op_xyn(0x8, 7, 0, 0xE), "SHL Vx");
+                a.emit(op_xkk(0x7, 0, 0x1D), "ADD Vx, byte");
+                break;
+
+            case Kind::DRW:
+                a.emit(op_xyn(0xD, 0, 1, params.param), "DRW Vx, Vy, n");
+                a.emit(op_xkk(0x7, 0, 0x03), "ADD Vx, byte");
+                a.emit(op_xkk(0x7, 1, 0x05), "ADD Vx, byte");
+                break;
+
+            case Kind::CALL:
+                callSites.push_back(a.here());
+                a.emit(0x2000, "CALL addr");
+                break;
+
+            case Kind::SMC:
+            {
+                // I points at the instruction right after Fx55
+                uint16_t target = static_cast<uint16_t>(a.here() + 3*Chip8::INSTRUCTION_SIZE_B);
+                a.emit(op_xkk(0x7, 1, 0x01), "ADD Vx, byte");
+                a.emit(op_nnn(0xA, target), "LD I, addr");
+                a.emit(op_xkk(0xF, 1, 0x55), "LD [I], Vx");
+                a.emit(op_xkk(0x6, 2, 0x00), "LD Vx, byte");
+                break;
+            }
+
+            case Kind::TIMER:
+            {
+                a.emit(op_xkk(0x6, 3, params.param), "LD Vx, byte");
+                a.emit(op_xkk(0xF, 3, 0x15), "LD DT, Vx");
+                uint16_t spinAddr = a.here();
+                a.emit(op_xkk(0xF, 3, 0x07));
+                a.emit(op_xkk(0x3, 3, 0x00));
+                a.emit(op_nnn(0x1, spinAddr));
+                break;
+            }
+        }
+    }
+
+    // loop control, see the cycle count below
+    uint16_t haltAddr;
+    if (0 == params.iterations)
+    {
+        a.emit(op_nnn(0x1, loopAddr), "JP addr");
+        haltAddr = a.here();
+    }
+    else
+    {
+        a.emit(op_xkk(0x7, 0xE, 0x01), "ADD Vx, byte");
+        a.emit(op_xkk(0x3, 0xE, 0x00), "SE Vx, byte");
+        a.emit(op_nnn(0x1, loopAddr), "JP addr");
+        a.count(false);
+        a.emit(op_xkk(0x7, 0xD, 0x01));
+        a.emit(op_xkk(0x3, 0xD, 0x00));
+        a.emit(op_nnn(0x1, loopAddr));
+        haltAddr = a.here();
+    }
+    a.emit(op_nnn(0x1, haltAddr));
+
+    if (Kind::CALL == params.kind)
+    {
+        // sub_0 calls sub_1 ... sub_{param-1} which does the work
+        std::vector<uint16_t> subAddrs;
+        for (uint8_t depth = 0; depth < params.param; depth++)
+        {
+            subAddrs.push_back(a.here());
+            if (depth + 1 < params.param)
+            {
+                a.emit(op_nnn(0x2, static_cast<uint16_t>(a.here() + 2*Chip8::INSTRUCTION_SIZE_B)));
+            }
+            else
+            {
+                a.emit(op_xkk(0x7, 0, 0x01));
+            }
+            a.emit(0x00EE);
+        }
+        for (auto site : callSites)
+        {
+            a.patch(site, op_nnn(0x2, subAddrs.front()));
+        }
+        // nested calls and returns happen once per copy
+        a.m_Mix["CALL addr"] += static_cast<unsigned>((params.param - 1)*params.unroll);
+        a.m_Mix["RET"] += static_cast<unsigned>(params.param*params.unroll);
+        a.m_Mix["ADD Vx, byte"] += params.unroll;
+    }
+
+    if (a.m_Rom.size() > (Chip8::PROGRAM_END_ADDR - Chip8::PROGRAM_START_ADDR + 1))
+    {
+        throw std::runtime_error(fmt::format(
+                    "Workload is {} bytes and does not fit in program memory, lower unroll", 
+                    a.m_Rom.size()));
+    }
+
+    Workload workload;
+    workload.rom = std::move(a.m_Rom);
+    workload.loopAddr = loopAddr;
+    workload.haltAddr = haltAddr;
+    workload.mixPerIteration = std::move(a.m_Mix);
+    workload.expectedCycles = 0;
+
+    if ((0 != params.iterations) and (Kind::TIMER != params.kind))
+    {
+        uint64_t prologue = (loopAddr - Chip8::PROGRAM_START_ADDR)/Chip8::INSTRUCTION_SIZE_B;
+        uint64_t body = 0;
+        for (const auto& [mnemonic, cnt] : workload.mixPerIteration)
+        {
+            body += cnt;
+        }
+        // body already includes ADD/SE/JP of a plain iteration, 3 cycles. When
+        // VE wraps the tail is ADD, SE (skip), ADD VD, SE VD, JP: 5 cycles, or
+        // 4 on the last iteration where SE VD skips the JP.
+        uint64_t n = params.iterations;
+        uint64_t wraps = 256 - (counter >> 8);
+        workload.expectedCycles = prologue + n*body + 2*(wraps - 1) + 1;
+    }
+
+    return workload;
+}
+
+WorkloadGenerator::Kind WorkloadGenerator::kindFromString(const std::string& name)
+{
+    static const std::map<std::string, Kind> kinds = 
+    {
+        {"alu", Kind::ALU}, {"drw", Kind::DRW}, {"call", Kind::CALL}, 
+        {"smc", Kind::SMC}, {"timer", Kind::TIMER},
+    };
+    auto kind = kinds.find(name);
+    if (kinds.end() == kind)
+    {
+        throw std::runtime_error(fmt::format(
+                    "Unknown workload '{}', must be one of alu, drw, call, smc, timer", name));
+    }
+    return kind->second;
+}
+
+std::string WorkloadGenerator::kindToString(Kind kind)
+{
+    switch (kind)
+    {
+        case Kind::ALU:   return "alu";
+        case Kind::DRW:   return "drw";
+        case Kind::CALL:  return "call";
+        case Kind::SMC:   return "smc";
+        case Kind::TIMER: return "timer";
+    }
+    return "unknown";
+}
+
+WorkloadGenerator::Params WorkloadGenerator::paramsFromString(const std::string& spec)
+{
+    std::vector<std::string> fields;
+    std::istringstream ss(spec);
+    std::string field;
+    while (std::getline(ss, field, ':'))
+    {
+        fields.push_back(field);
+    }
+    if (fields.empty() or (fields.size() > 5))
+    {
+        throw std::runtime_error(fmt::format(
+                    "Bad workload '{}', expected kind[:iterations[:unroll[:param[:seed]]]]", spec));
+    }
+
+    // the whole field has to be a number no larger than max
+    auto number = [&spec, &fields](std::size_t index, const char* name, unsigned long max)
+    {
+        unsigned long value = 0;
+        std::size_t len = 0;
+        try
+        {
+            value = std::stoul(fields[index], &len);
+        }
+        catch (const std::logic_error&)
+        {
+        }
+        if ((0 == len) or (len != fields[index].size()))
+        {
+            throw std::runtime_error(fmt::format(
+                        "Bad workload '{}', {} must be a number, got '{}'", spec, name, fields[index]));
+        }
+        if (value > max)
+        {
+            throw std::runtime_error(fmt::format(
+                        "Bad workload '{}', {} must be at most {}, got {}", spec, name, max, value));
+        }
+        return value;
+    };
+
+    Params params{kindFromString(fields[0]), DEFAULT_ITERATIONS, DEFAULT_UNROLL, DEFAULT_PARAM, 0};
+    if (fields.size() > 1)
+    {
+        // 0 loops forever
+        params.iterations = static_cast<uint16_t>(number(1, "iterations", 0xFFFF));
+    }
+    if (fields.size() > 2)
+    {
+        params.unroll = static_cast<uint8_t>(number(2, "unroll", 0xFF));
+    }
+    if (fields.size() > 3)
+    {
+        params.param = static_cast<uint8_t>(number(3, "param", 0xFF));
+    }
+    if (fields.size() > 4)
+    {
+        params.seed = static_cast<uint32_t>(number(4, "seed", 0xFFFFFFFF));
+    }
+    return params;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Chip8.hxx"
+
+// Builds Chip-8 programs with a known instruction mix for benchmarking.
+//
+// Every program is a prologue, a loop whose body is `unroll` copies of the
+// workload and a 16 bit loop counter in VD:VE, then a `JP self` halt. With
+// iterations = 0 the loop never ends. Nothing reads keys or RND, so the final
+// state only depends on the parameters (and, for TIMER, on cycles per frame).
+//
+//   ALU   - 8xyN and 7xkk on V0-V7
+//   DRW   - Dxyn with n = param (1-15) while walking x and y
+//   CALL  - a chain of param (1-15) nested subroutines per body
+//   SMC   - rewrites an instruction with Fx55 and then executes it
+//   TIMER - sets DT to param and spins on Fx07 until it reaches zero
+class WorkloadGenerator
+{
+    public:
+        enum class Kind
+        {
+            ALU,
+            DRW,
+            CALL,
+            SMC,
+            TIMER
+        };
+
+        typedef struct
+        {
+            Kind kind;
+            uint16_t iterations;
+            uint8_t unroll;
+            uint8_t param;
+            uint32_t seed;
+        } Params;
+
+        typedef struct
+        {
+            std::vector<uint8_t> rom;
+            uint16_t loopAddr;
+            uint16_t haltAddr;
+            // cycles until PC reaches haltAddr, 0 if it is not known up front
+            uint64_t expectedCycles;
+            // mnemonic -> count for one loop iteration, loop control included
+            std::map<std::string, unsigned> mixPerIteration;
+        } Workload;
+
+        static constexpr uint8_t DEFAULT_UNROLL = 8;
+        static constexpr uint8_t DEFAULT_PARAM = 5;
+        static constexpr uint16_t DEFAULT_ITERATIONS = 1000;
+
+        static Workload generate(const Params& params);
+        static Kind kindFromString(const std::string& name);
+        static std::string kindToString(Kind kind);
+        // "kind[:iterations[:unroll[:param[:seed]]]]", e.g. "drw:1000:8:5"
+        static Params paramsFromString(const std::string& spec);
+};
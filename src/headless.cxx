@@ -0,0 +1,194 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+
+#include <cxxopts.hpp>
+
+#include "Chip8Headless.hxx"
+
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options(std::string{argv[0]}, "Chip 8 Headless Runner");
+    options.add_options()
+        ("c,clk-hz", "Clock frequency in herz", 
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(Chip8Headless::DEFAULT_CLK_HZ)))
+        ("n,cycles", "Number of cycles to run", cxxopts::value<uint64_t>())
+        ("f,frames", "Number of 60Hz frames to run", cxxopts::value<uint64_t>())
+        ("i,input", "Input script, one '<frame> <key> <down|up>' per line", 
+         cxxopts::value<std::string>())
+        ("g,gfx", "Print the final screen")
+        ("p,perf", "Report hardware performance counters for the run")
+        ("w,workload", "Run a generated workload instead of a rom, "
+         "kind[:iterations[:unroll[:param[:seed]]]] e.g. drw:1000:8:5", 
+         cxxopts::value<std::string>())
+        ("seed", "Seed of the CXkk random numbers", cxxopts::value<uint64_t>()->default_value("0"))
+        ("stream", "Random stream, instances with the same seed and different streams draw "
+         "different numbers", cxxopts::value<uint64_t>()->default_value("0"))
+        ("halt", "Stop early when the program jumps to itself")
+        ("profile-out", "Write the execution profile to this file, "
+         "needs a -DBUILD_PROFILER_PACKAGE=ON build", cxxopts::value<std::string>())
+        ("coverage-out", "Write <base>.pgm and <base>.csv memory access heatmaps, "
+         "needs a -DBUILD_COVERAGE_PACKAGE=ON build", cxxopts::value<std::string>())
+        ("folded-out", "Sample the guest call stack and write folded stacks "
+         "to this file, for flamegraph.pl", cxxopts::value<std::string>())
+        ("sample-every", "Cycles between two call stack samples",
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(Chip8StackSampler::DEFAULT_PERIOD_CYCLES)))
+        ("trace-out", "Record a binary trace of every cycle to this file, "
+         "decode it with CppChip8-tracedump", cxxopts::value<std::string>())
+        ("trace-records", "Trace ring size, only the last records are kept",
+         cxxopts::value<uint32_t>()->default_value(
+             std::to_string(Chip8TraceRecorder::DEFAULT_CAPACITY)))
+        ("load-state", "Resume from this save state, it has to belong to the rom",
+         cxxopts::value<std::string>())
+        ("save-state", "Write a save state to this file when the run ends",
+         cxxopts::value<std::string>())
+        ("rewind-kb", "Record every frame into a rewind history of this many KB "
+         "and report what it costs", cxxopts::value<std::size_t>())
+        ("frame-cache", "Memoize up to this many frames and load the state a frame ended in "
+         "when it starts from a state and keys seen before", cxxopts::value<std::size_t>())
+        ("movie", "Replay this movie at full speed and check that it ends in the recorded state, "
+         "sets the clock and, without --cycles or --frames, the length", cxxopts::value<std::string>())
+        ("crash-dump", "Where the state and the last instructions go when the rom faults, "
+         "empty to disable", cxxopts::value<std::string>()->default_value("chip8-crash.log"))
+        ("h,help", "Display usage")
+        ("rom-path", "Full path to rom", cxxopts::value<std::string>())
+        ;
+    options.positional_help("<full path to rom>");
+    options.parse_positional({"rom-path"});
+    auto result = options.parse(argc, argv);
+    auto romPathCount = result.count("rom-path") + result.count("workload");
+    auto lengthCount = result.count("cycles") + result.count("frames");
+    if ((result.count("help") >= 1) or (1 != romPathCount) or (lengthCount > 1) or
+            ((0 == lengthCount) and (0 == result.count("movie"))))
+    {
+        std::cerr << options.help() << std::endl;
+        std::cerr << "Exactly one rom or --workload and one of --cycles, --frames or --movie are required" << std::endl;
+        std::exit(0);
+    }
+
+    if (result.count("movie") and result.count("input"))
+    {
+        std::cerr << "A movie holds its own keys, --movie can not be combined with --input" << std::endl;
+        return 1;
+    }
+    if (result.count("movie") and result.count("load-state"))
+    {
+        std::cerr << "A movie starts from reset, --movie can not be combined with --load-state" << std::endl;
+        return 1;
+    }
+    if (result.count("coverage-out") and not Chip8CoveragePolicy::IS_ENABLED)
+    {
+        std::cerr << "--coverage-out needs a -DBUILD_COVERAGE_PACKAGE=ON build" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        std::unique_ptr<Chip8Movie> movie;
+        unsigned clkHz = result["clk-hz"].as<unsigned>();
+        if (result.count("movie"))
+        {
+            movie = std::make_unique<Chip8Movie>(result["movie"].as<std::string>());
+            clkHz = movie->getClkHz();
+        }
+        Chip8Headless emu(clkHz);
+        if (result.count("workload"))
+        {
+            emu.loadWorkload(WorkloadGenerator::paramsFromString(result["workload"].as<std::string>()));
+        }
+        else
+        {
+            emu.loadRom(result["rom-path"].as<std::string>());
+        }
+        emu.setStopOnHalt(result["halt"].as<bool>());
+        emu.setRandomSeed(result["seed"].as<uint64_t>(), result["stream"].as<uint64_t>());
+        if (result["perf"].as<bool>())
+        {
+            emu.enablePerfCounters();
+        }
+        if (result.count("folded-out"))
+        {
+            emu.enableStackSampler(result["sample-every"].as<unsigned>());
+        }
+        emu.setCrashDumpPath(result["crash-dump"].as<std::string>());
+        if (result.count("trace-out"))
+        {
+            emu.enableTrace(result["trace-out"].as<std::string>(), result["trace-records"].as<uint32_t>());
+        }
+        if (result.count("rewind-kb"))
+        {
+            emu.enableRewind(1024*result["rewind-kb"].as<std::size_t>());
+        }
+        if (result.count("frame-cache"))
+        {
+            emu.enableFrameCache(result["frame-cache"].as<std::size_t>());
+        }
+        if (result.count("load-state"))
+        {
+            emu.loadState(result["load-state"].as<std::string>());
+        }
+        if (result.count("input"))
+        {
+            emu.loadInputScript(result["input"].as<std::string>());
+        }
+        if (movie)
+        {
+            emu.loadMovie(*movie);
+        }
+
+        if (result.count("cycles"))
+        {
+            emu.runCycles(result["cycles"].as<uint64_t>());
+        }
+        else if (result.count("frames"))
+        {
+            emu.runFrames(result["frames"].as<uint64_t>());
+        }
+        else
+        {
+            emu.runFrames(movie->getFrameCount());
+        }
+
+        emu.printReport(std::cout, result["gfx"].as<bool>());
+        if (movie)
+        {
+            bool isVerified = emu.isMovieVerified();
+            std::cout << "movie_verified: " << (isVerified ? "true" : "false") << std::endl;
+            if (not isVerified)
+            {
+                return 1;
+            }
+        }
+        if (result.count("save-state"))
+        {
+            emu.saveState(result["save-state"].as<std::string>());
+        }
+        if (result.count("profile-out"))
+        {
+            std::ofstream profile(result["profile-out"].as<std::string>());
+            emu.getCpu().writeProfileReport(profile);
+        }
+        if (result.count("coverage-out"))
+        {
+            emu.getCpu().writeCoverage(result["coverage-out"].as<std::string>());
+        }
+        if (result.count("folded-out"))
+        {
+            std::ofstream folded(result["folded-out"].as<std::string>());
+            emu.writeFoldedStacks(folded);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
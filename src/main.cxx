@@ -1,6 +1,9 @@
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <algorithm>
+
+#include <fmt/core.h>
 
 #include <cxxopts.hpp>
 
@@ -17,6 +20,48 @@ int main(int argc, char** argv)
         ("s,sleep-ms", "Amount of sleep time in ms after instruction have been executed", 
          cxxopts::value<unsigned>()->default_value(
              std::to_string(Chip8Emulator::DEFAULT_CYCLE_SLEEP_mS)))
+        ("b,benchmark-frames", "Render this many frames as fast as possible and report timings", 
+         cxxopts::value<uint64_t>())
+        ("i,input", "Input script for --benchmark-frames, one '<frame> <key> <down|up>' per line", 
+         cxxopts::value<std::string>()->default_value(""))
+        ("video-driver", "SDL video driver, e.g. offscreen or dummy", 
+         cxxopts::value<std::string>()->default_value(""))
+        ("software-renderer", "Use SDL's software renderer")
+        ("profile-out", "Write the execution profile to this file on exit, "
+         "needs a -DBUILD_PROFILER_PACKAGE=ON build", cxxopts::value<std::string>()->default_value(""))
+        ("coverage-out", "Write <base>.pgm and <base>.csv memory access heatmaps on exit, "
+         "needs a -DBUILD_COVERAGE_PACKAGE=ON build", cxxopts::value<std::string>()->default_value(""))
+        ("folded-out", "Sample the guest call stack and write folded stacks "
+         "to this file on exit, for flamegraph.pl", cxxopts::value<std::string>()->default_value(""))
+        ("sample-every", "Cycles between two call stack samples",
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(Chip8StackSampler::DEFAULT_PERIOD_CYCLES)))
+        ("trace-out", "Record a binary trace of every cycle to this file, "
+         "decode it with CppChip8-tracedump", cxxopts::value<std::string>())
+        ("trace-records", "Trace ring size, only the last records are kept",
+         cxxopts::value<uint32_t>()->default_value(
+             std::to_string(Chip8TraceRecorder::DEFAULT_CAPACITY)))
+        ("crash-dump", "Where the state and the last instructions go when the rom faults, "
+         "empty to disable", cxxopts::value<std::string>()->default_value("chip8-crash.log"))
+        ("timeline-out", "Write a Chrome trace event timeline of the emulator loop "
+         "phases to this file on exit", cxxopts::value<std::string>()->default_value(""))
+        ("metrics-out", "Export metrics in the Prometheus text format to this file "
+         "or to unix:<socket path>", cxxopts::value<std::string>()->default_value(""))
+        ("metrics-interval-ms", "How often the metrics file is rewritten",
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(MetricsExporter::DEFAULT_PERIOD_mS)))
+        ("latency-out", "Follow key presses to the screen and write input to photon "
+         "latency histograms to this file on exit", cxxopts::value<std::string>()->default_value(""))
+        ("state-slot", "Save state slot, F5 saves to <rom>.<slot>.state and F9 loads it",
+         cxxopts::value<unsigned>()->default_value("0"))
+        ("resume", "Start from the save state in --state-slot")
+        ("rewind-kb", "Rewind history budget in KB, hold Backspace to rewind, 0 disables",
+         cxxopts::value<std::size_t>()->default_value(std::to_string(Chip8Rewind::DEFAULT_BUDGET_B/1024)))
+        ("run-ahead", "Frames to emulate ahead of the one shown, hides that many frames of input lag",
+         cxxopts::value<unsigned>()->default_value("0"))
+        ("movie-out", "Record the session to this movie file, replay it with CppChip8-headless --movie",
+         cxxopts::value<std::string>()->default_value(""))
+        ("overlay", "Start with the performance overlay shown, F1 toggles it")
         ("h,help", "Display usage")
         ("rom-path", "Full path to rom", cxxopts::value<std::string>())
         ;
@@ -29,9 +74,92 @@ int main(int argc, char** argv)
         std::cerr << options.help() << std::endl;
         std::exit(0);
     }
+    if (result["resume"].as<bool>() and not result["movie-out"].as<std::string>().empty())
+    {
+        std::cerr << "A movie starts from reset, --movie-out can not be combined with --resume" << std::endl;
+        return 1;
+    }
+    if (0 == result["metrics-interval-ms"].as<unsigned>())
+    {
+        std::cerr << "--metrics-interval-ms has to be at least 1" << std::endl;
+        return 1;
+    }
+    if (not result["coverage-out"].as<std::string>().empty() and not Chip8CoveragePolicy::IS_ENABLED)
+    {
+        std::cerr << "--coverage-out needs a -DBUILD_COVERAGE_PACKAGE=ON build" << std::endl;
+        return 1;
+    }
 
-    Chip8Emulator emu(result["clk-hz"].as<unsigned>(), result["sleep-ms"].as<unsigned>());
+    Chip8Emulator emu(
+            result["clk-hz"].as<unsigned>(), 
+            result["sleep-ms"].as<unsigned>(),
+            result["video-driver"].as<std::string>(),
+            result["software-renderer"].as<bool>()
+            );
     emu.loadRom(result["rom-path"].as<std::string>());
+    emu.setProfileReportPath(result["profile-out"].as<std::string>());
+    emu.setCoveragePath(result["coverage-out"].as<std::string>());
+    emu.setFoldedStacksPath(
+            result["folded-out"].as<std::string>(),
+            result["sample-every"].as<unsigned>());
+    emu.setCrashDumpPath(result["crash-dump"].as<std::string>());
+    emu.setTimelinePath(result["timeline-out"].as<std::string>());
+    emu.setInputLatencyPath(result["latency-out"].as<std::string>());
+    emu.setStateSlot(result["state-slot"].as<unsigned>());
+    emu.enableRewind(1024*result["rewind-kb"].as<std::size_t>());
+    emu.setRunAhead(result["run-ahead"].as<unsigned>());
+    if (not result["movie-out"].as<std::string>().empty())
+    {
+        emu.recordMovie(result["movie-out"].as<std::string>());
+    }
+    if (result["overlay"].as<bool>())
+    {
+        emu.toggleOverlay();
+    }
+    if (not result["metrics-out"].as<std::string>().empty())
+    {
+        emu.enableMetrics(
+                result["metrics-out"].as<std::string>(),
+                result["metrics-interval-ms"].as<unsigned>());
+    }
+    if (result.count("trace-out"))
+    {
+        emu.enableTrace(result["trace-out"].as<std::string>(), result["trace-records"].as<uint32_t>());
+    }
+
+    if (result["resume"].as<bool>())
+    {
+        try
+        {
+            emu.loadStateSlot();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (result.count("benchmark-frames"))
+    {
+        auto r = emu.benchmark(
+                result["benchmark-frames"].as<uint64_t>(), 
+                result["input"].as<std::string>());
+        auto frames = static_cast<double>(std::max<uint64_t>(1, r.frames));
+        std::cout << fmt::format("frames: {}\n", r.frames);
+        std::cout << fmt::format("cycles: {}\n", r.cycles);
+        std::cout << fmt::format("fps: {:.1f}\n", static_cast<double>(r.frames)/r.total.count());
+        std::cout << fmt::format("draw_calls_per_frame: {:.2f}\n", static_cast<double>(r.drawCalls)/frames);
+        std::cout << fmt::format("presents_per_frame: {:.2f}\n", static_cast<double>(r.presents)/frames);
+        std::cout << fmt::format("emulate_us_per_frame: {:.3f}\n", 1e6*r.emulate.count()/frames);
+        std::cout << fmt::format("render_us_per_frame: {:.3f}\n", 1e6*r.render.count()/frames);
+        std::cout << fmt::format("present_us_per_frame: {:.3f}\n", 1e6*r.present.count()/frames);
+        emu.writeProfileReport();
+        emu.writeCoverage();
+        emu.writeTimeline();
+        return 0;
+    }
+
     emu.run();
     
     return 0;
@@ -0,0 +1,108 @@
+#include <sys/resource.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <exception>
+
+#include <fmt/core.h>
+#include <cxxopts.hpp>
+
+#include "Chip8Search.hxx"
+
+
+int main(int argc, char** argv)
+{
+    auto defaults = Chip8Search::defaultParams();
+    cxxopts::Options options(std::string{argv[0]}, "Chip 8 Input Search");
+    options.add_options()
+        ("c,clk-hz", "Clock frequency in herz",
+         cxxopts::value<unsigned>()->default_value(std::to_string(defaults.clkHz)))
+        ("g,goal", "Stop at the first state where mem:<addr><=|!=|<|><value>, "
+         "pixel:<col>,<row> is on or the rom faults, e.g. mem:0x3A0>9",
+         cxxopts::value<std::string>())
+        ("d,max-depth", "Steps from reset to give up at",
+         cxxopts::value<unsigned>()->default_value(std::to_string(defaults.maxDepth)))
+        ("s,max-states", "Unique states to give up at",
+         cxxopts::value<uint64_t>()->default_value(std::to_string(defaults.maxStates)))
+        ("f,frames-per-step", "Frames every key is held for",
+         cxxopts::value<unsigned>()->default_value(std::to_string(defaults.framesPerStep)))
+        ("t,threads", "Worker threads, all cores by default",
+         cxxopts::value<unsigned>()->default_value(std::to_string(defaults.threads)))
+        ("seed", "Seed of the CXkk random numbers", cxxopts::value<uint64_t>()->default_value("0"))
+        ("stream", "Random stream of the CXkk random numbers", cxxopts::value<uint64_t>()->default_value("0"))
+        ("movie-out", "Write the keys that reach the goal as a movie, "
+         "CppChip8-headless --movie replays them", cxxopts::value<std::string>())
+        ("h,help", "Display usage")
+        ("rom-path", "Full path to rom", cxxopts::value<std::string>())
+        ;
+    options.positional_help("<full path to rom>");
+    options.parse_positional({"rom-path"});
+    auto result = options.parse(argc, argv);
+    if ((result.count("help") >= 1) or (1 != result.count("rom-path")) or (1 != result.count("goal")))
+    {
+        std::cerr << options.help() << std::endl;
+        std::cerr << "A rom and a --goal are required" << std::endl;
+        std::exit(0);
+    }
+
+    try
+    {
+        Chip8Search::Params params
+        {
+            result["clk-hz"].as<unsigned>(),
+            result["max-depth"].as<unsigned>(),
+            result["max-states"].as<uint64_t>(),
+            result["frames-per-step"].as<unsigned>(),
+            result["threads"].as<unsigned>(),
+            result["seed"].as<uint64_t>(),
+            result["stream"].as<uint64_t>()
+        };
+        auto goal = Chip8Search::goalFromString(result["goal"].as<std::string>());
+        Chip8Search search(params);
+        auto found = search.run(result["rom-path"].as<std::string>(), goal);
+
+        double elapsed = found.elapsed.count();
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        std::cout << fmt::format("found: {}\n", found.isFound);
+        std::cout << fmt::format("depth: {}\n", found.depth);
+        std::cout << fmt::format("frames: {}\n", found.frameKeys.size());
+        std::cout << fmt::format("expanded: {}\n", found.expanded);
+        std::cout << fmt::format("states: {}\n", found.states);
+        std::cout << fmt::format("duplicates: {}\n", found.duplicates);
+        std::cout << fmt::format("faults: {}\n", found.faults);
+        std::cout << fmt::format("threads: {}\n", params.threads);
+        std::cout << fmt::format("elapsed_s: {:.6f}\n", elapsed);
+        std::cout << fmt::format("states_per_s: {:.0f}\n",
+                (elapsed > 0.0) ? static_cast<double>(found.states)/elapsed : 0.0);
+        std::cout << fmt::format("steps_per_s: {:.0f}\n", (elapsed > 0.0) ?
+                static_cast<double>(found.states + found.duplicates + found.faults)/elapsed : 0.0);
+        std::cout << fmt::format("search_peak_kb: {}\n", found.peakBytes/1024);
+        std::cout << fmt::format("max_rss_kb: {}\n", usage.ru_maxrss);
+        if (found.isFound)
+        {
+            std::cout << fmt::format("state_hash: 0x{:016X}\n", found.finalStateHash);
+            std::cout << "keys:";
+            for (std::size_t frame = 0; frame < found.frameKeys.size(); frame += params.framesPerStep)
+            {
+                std::cout << fmt::format(" {:04X}", found.frameKeys[frame]);
+            }
+            std::cout << std::endl;
+        }
+        if (found.isFound and result.count("movie-out"))
+        {
+            search.toMovie(found).save(result["movie-out"].as<std::string>());
+        }
+        if (not found.isFound)
+        {
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <exception>
+#include <algorithm>
+
+#include <fmt/core.h>
+#include <cxxopts.hpp>
+
+#include "Chip8TraceReader.hxx"
+
+// Index of the first record of trace with the given cycle, trace.size() if
+// there is none
+static uint64_t findCycle(const Chip8TraceReader& trace, uint64_t cycle)
+{
+    for (uint64_t idx = 0; idx < trace.size(); idx++)
+    {
+        if (trace.at(idx).cycle >= cycle)
+        {
+            return idx;
+        }
+    }
+    return trace.size();
+}
+
+// Walks both traces from the first cycle they have in common, returns false
+// and prints the surrounding records on the first mismatch
+static bool diff(const Chip8TraceReader& a, const Chip8TraceReader& b, uint64_t context)
+{
+    if ((0 == a.size()) or (0 == b.size()))
+    {
+        std::cout << "one of the traces is empty\n";
+        return a.size() == b.size();
+    }
+    uint64_t firstCycle = std::max(a.at(0).cycle, b.at(0).cycle);
+    uint64_t idxA = findCycle(a, firstCycle);
+    uint64_t idxB = findCycle(b, firstCycle);
+    uint64_t cnt = std::min(a.size() - idxA, b.size() - idxB);
+    for (uint64_t n = 0; n < cnt; n++)
+    {
+        if (Chip8TraceReader::isSame(a.at(idxA + n), b.at(idxB + n)))
+        {
+            continue;
+        }
+
+        uint64_t from = n - std::min(n, context);
+        uint64_t to = std::min(cnt, n + context + 1);
+        std::cout << fmt::format("traces diverge at cycle {}\n", a.at(idxA + n).cycle);
+        for (const auto& [name, trace, idx] : {std::tuple{"a", &a, idxA}, std::tuple{"b", &b, idxB}})
+        {
+            std::cout << fmt::format("--- {}\n", name);
+            for (uint64_t m = from; m < to; m++)
+            {
+                std::cout << ((m == n) ? "> " : "  ") << Chip8TraceReader::format(trace->at(idx + m)) << "\n";
+            }
+        }
+        return false;
+    }
+    std::cout << fmt::format("{} common records match\n", cnt);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options(std::string{argv[0]}, "Chip 8 Trace Decoder");
+    options.add_options()
+        ("s,skip", "Records to skip before printing", cxxopts::value<uint64_t>()->default_value("0"))
+        ("n,count", "Records to print", 
+         cxxopts::value<uint64_t>()->default_value(std::to_string(UINT64_MAX)))
+        ("d,diff", "Compare two traces and show the first divergence")
+        ("C,context", "Records around the divergence", cxxopts::value<uint64_t>()->default_value("5"))
+        ("h,help", "Display usage")
+        ("traces", "Trace files", cxxopts::value<std::vector<std::string>>())
+        ;
+    options.positional_help("<trace> [<other trace>]");
+    options.parse_positional({"traces"});
+    auto result = options.parse(argc, argv);
+    auto traceCount = result.count("traces") ? result["traces"].as<std::vector<std::string>>().size() : 0;
+    bool isDiff = result["diff"].as<bool>();
+    if ((result.count("help") >= 1) or (traceCount != (isDiff ? 2U : 1U)))
+    {
+        std::cerr << options.help() << std::endl;
+        std::cerr << "One trace, or two with --diff, is required" << std::endl;
+        std::exit(0);
+    }
+
+    try
+    {
+        auto paths = result["traces"].as<std::vector<std::string>>();
+        Chip8TraceReader trace(paths[0]);
+        if (isDiff)
+        {
+            Chip8TraceReader other(paths[1]);
+            return diff(trace, other, result["context"].as<uint64_t>()) ? 0 : 1;
+        }
+        trace.dump(std::cout, result["skip"].as<uint64_t>(), result["count"].as<uint64_t>());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <exception>
+
+#include <fmt/core.h>
+#include <cxxopts.hpp>
+
+#include "WorkloadGenerator.hxx"
+
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options(std::string{argv[0]}, "Chip 8 Workload Generator");
+    options.add_options()
+        ("n,iterations", "Loop iterations, 0 loops forever", 
+         cxxopts::value<uint16_t>()->default_value(
+             std::to_string(WorkloadGenerator::DEFAULT_ITERATIONS)))
+        ("u,unroll", "Copies of the workload in the loop body", 
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(WorkloadGenerator::DEFAULT_UNROLL)))
+        ("p,param", "Sprite rows for drw, call depth for call, DT value for timer", 
+         cxxopts::value<unsigned>()->default_value(
+             std::to_string(WorkloadGenerator::DEFAULT_PARAM)))
+        ("s,seed", "Seed for the initial register values", 
+         cxxopts::value<uint32_t>()->default_value("0"))
+        ("o,output", "Output rom", cxxopts::value<std::string>())
+        ("h,help", "Display usage")
+        ("kind", "alu, drw, call, smc or timer", cxxopts::value<std::string>())
+        ;
+    options.positional_help("<alu|drw|call|smc|timer>");
+    options.parse_positional({"kind"});
+    auto result = options.parse(argc, argv);
+    if ((result.count("help") >= 1) or (1 != result.count("kind")) or (1 != result.count("output")))
+    {
+        std::cerr << options.help() << std::endl;
+        std::exit(0);
+    }
+
+    try
+    {
+        WorkloadGenerator::Params params
+        {
+            WorkloadGenerator::kindFromString(result["kind"].as<std::string>()),
+            result["iterations"].as<uint16_t>(),
+            static_cast<uint8_t>(result["unroll"].as<unsigned>()),
+            static_cast<uint8_t>(result["param"].as<unsigned>()),
+            result["seed"].as<uint32_t>()
+        };
+        auto workload = WorkloadGenerator::generate(params);
+
+        auto romPath = result["output"].as<std::string>();
+        std::ofstream rom(romPath, std::ios::out | std::ios::binary);
+        rom.write(reinterpret_cast<const char *>(workload.rom.data()), 
+                static_cast<std::streamsize>(workload.rom.size()));
+        if (not rom.good())
+        {
+            throw std::runtime_error("Unable to write " + romPath);
+        }
+
+        std::cout << fmt::format("rom: {} ({} bytes)\n", romPath, workload.rom.size());
+        std::cout << fmt::format("loop_addr: 0x{:03X}\n", workload.loopAddr);
+        std::cout << fmt::format("halt_addr: 0x{:03X}\n", workload.haltAddr);
+        std::cout << fmt::format("expected_cycles: {}\n", workload.expectedCycles);
+        for (const auto& [mnemonic, cnt] : workload.mixPerIteration)
+        {
+            std::cout << fmt::format("mix: {}: {}\n", mnemonic, cnt);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -6,9 +6,25 @@
 #include <cstddef>
 #include <random>
 #include <limits>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
 
 
 #include "Chip8.hxx"
+#include "Chip8SaveState.hxx"
+#include "Chip8Rewind.hxx"
+#include "Chip8Movie.hxx"
+#include "Chip8Search.hxx"
+#include "Chip8FrameCache.hxx"
+#include "Chip8TraceReader.hxx"
+#include "Chip8Coverage.hxx"
+#include "Chip8Profiler.hxx"
+#include "InputLatency.hxx"
+#include "InputScript.hxx"
+#include "Chip8Headless.hxx"
 
 struct RomWriter
 {
@@ -1371,6 +1387,99 @@ TEST_F(Chip8Fixture, Test_op_sknp)
         w.reset();
     }
 }
+
+TEST_F(Chip8Fixture, Test_key_reads)
+{
+    w.writeOp(0x6005);
+    w.writeOp(0xE09E);
+    w.writeOp(0xE0A1);
+    // skipped, key 5 is up
+    w.writeOp(0x1200);
+    w.writeOp(0xF20A);
+    w.done();
+    chip8.loadRom(w.filename);
+
+    chip8.emulateCycle();
+    EXPECT_EQ(0, chip8.getKeyReads());
+    chip8.emulateCycle();
+    EXPECT_EQ(1 << 5, chip8.getKeyReads());
+    chip8.clearKeyReads();
+    EXPECT_EQ(0, chip8.getKeyReads());
+
+    chip8.emulateCycle();
+    EXPECT_EQ(1 << 5, chip8.getKeyReads());
+    chip8.clearKeyReads();
+
+    // Fx0A looks at every key while it waits
+    chip8.emulateCycle();
+    EXPECT_TRUE(chip8.isKeyWait());
+    EXPECT_EQ(0xFFFF, chip8.getKeyReads());
+}
+
+TEST_F(Chip8Fixture, Test_input_latency)
+{
+    // reads key 5 until it is pressed, then draws a digit
+    w.writeOp(0x6005);
+    w.writeOp(0xE09E);
+    w.writeOp(0x1202);
+    w.writeOp(0xA050);
+    w.writeOp(0xD115);
+    w.writeOp(0x120A);
+    w.done();
+    chip8.loadRom(w.filename);
+    auto runCycles = [](InputLatency& latency, unsigned cnt)
+    {
+        for (unsigned i = 0; i < cnt; i++)
+        {
+            chip8.emulateCycle();
+            latency.onCycle(chip8);
+        }
+    };
+    auto text = [](const InputLatency& latency)
+    {
+        std::ostringstream os;
+        latency.write(os);
+        return os.str();
+    };
+
+    // read, DRW, present: one press on the screen
+    InputLatency latency(9);
+    chip8.emulateCycle();
+    latency.onKeyDown(chip8, 5, InputLatency::clock::now());
+    latency.onPresent();
+    EXPECT_EQ(0, latency.getCount());
+    chip8.setKey(5, true);
+    runCycles(latency, 3);
+    latency.onPresent();
+    EXPECT_EQ(1, latency.getCount());
+
+    // the guest reads the key but never draws, a DRW after the timeout is
+    // not taken for the answer
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    InputLatency noDrw(1);
+    noDrw.onKeyDown(chip8, 5, InputLatency::clock::now());
+    runCycles(noDrw, 2*InputLatency::MAX_DRW_FRAMES);
+    chip8.setKey(5, true);
+    runCycles(noDrw, 3);
+    noDrw.onPresent();
+    EXPECT_EQ(0, noDrw.getCount());
+    EXPECT_NE(std::string::npos, text(noDrw).find("chip8_input_no_drw_total 1\n"));
+
+    // a newer press replaces one that was read but not drawn yet
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    InputLatency replaced(9);
+    replaced.onKeyDown(chip8, 5, InputLatency::clock::now());
+    runCycles(replaced, 2);
+    replaced.onKeyDown(chip8, 5, InputLatency::clock::now());
+    chip8.setKey(5, true);
+    runCycles(replaced, 4);
+    replaced.onPresent();
+    EXPECT_EQ(1, replaced.getCount());
+    EXPECT_NE(std::string::npos, text(replaced).find("chip8_input_abandoned_total 1\n"));
+}
+
 // Fx15 - LD DT, Vx
 // Set delay timer = Vx.
 //
@@ -1843,3 +1952,787 @@ TEST_F(Chip8Fixture, Test_op_ldxi)
     }
 
 }
+
+TEST_F(Chip8Fixture, Test_save_load_state)
+{
+    // 0x200: CALL 0x206, 0x202: JP 0x202, 0x206: ADD V1, 1, 0x208: JP 0x206
+    w.writeOp(0x2206);
+    w.writeOp(0x1202);
+    w.writeOp(0x0000);
+    w.writeOp(0x7101);
+    w.writeOp(0x1206);
+    w.done();
+    chip8.loadRom(w.filename);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        chip8.emulateCycle();
+    }
+
+    Chip8State snapshot;
+    chip8.saveState(snapshot);
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        chip8.emulateCycle();
+    }
+    EXPECT_EQ(4, chip8.getV(1));
+
+    chip8.loadState(snapshot);
+    EXPECT_EQ(1, chip8.getV(1));
+    EXPECT_EQ(0x206, chip8.getPC());
+    EXPECT_EQ(3, chip8.getCycleCount());
+    auto stack = chip8.getStack();
+    ASSERT_EQ(1, stack.size());
+    EXPECT_EQ(0x202, stack.top());
+}
+
+TEST_F(Chip8Fixture, Test_save_state_file)
+{
+    w.writeOp(0x7101);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        chip8.emulateCycle();
+    }
+    Chip8SaveState::save(chip8, "rom.state");
+    chip8.emulateCycle();
+    EXPECT_EQ(3, chip8.getV(1));
+
+    Chip8SaveState::load(chip8, "rom.state");
+    EXPECT_EQ(2, chip8.getV(1));
+    EXPECT_EQ(4, chip8.getCycleCount());
+
+    // a state only loads into the ROM it was saved from
+    chip8.reset();
+    w.reset();
+    w.writeOp(0x7102);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    EXPECT_THROW(Chip8SaveState::load(chip8, "rom.state"), std::runtime_error);
+    std::remove("rom.state");
+}
+
+TEST_F(Chip8Fixture, Test_save_state_tampered)
+{
+    w.writeOp(0x2204);
+    w.writeOp(0x1202);
+    w.writeOp(0x00EE);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.emulateCycle();
+    Chip8SaveState::save(chip8, "rom.state");
+
+    auto tamper = [](std::size_t offset, const std::vector<uint8_t>& bytes)
+    {
+        std::fstream file("rom.state", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(sizeof(Chip8SaveState::FileHeader) + offset));
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    };
+    // a stack index past the 16 entries, anything but the empty marker
+    tamper(offsetof(Chip8State, sp), {Chip8State::STACK_SIZE});
+    EXPECT_THROW(Chip8SaveState::load(chip8, "rom.state"), std::runtime_error);
+    tamper(offsetof(Chip8State, sp), {0x7F});
+    EXPECT_THROW(Chip8SaveState::load(chip8, "rom.state"), std::runtime_error);
+    tamper(offsetof(Chip8State, sp), {0x00});
+    EXPECT_NO_THROW(Chip8SaveState::load(chip8, "rom.state"));
+
+    tamper(offsetof(Chip8State, pc), {0x00, 0x10});
+    EXPECT_THROW(Chip8SaveState::load(chip8, "rom.state"), std::runtime_error);
+    tamper(offsetof(Chip8State, pc), {0x04, 0x02});
+    tamper(offsetof(Chip8State, i), {0xFF, 0xFF});
+    EXPECT_THROW(Chip8SaveState::load(chip8, "rom.state"), std::runtime_error);
+    tamper(offsetof(Chip8State, i), {0xFF, 0x0F});
+    EXPECT_NO_THROW(Chip8SaveState::load(chip8, "rom.state"));
+
+    // the good state left loaded runs the RET
+    chip8.emulateCycle();
+    EXPECT_EQ(0x202, chip8.getPC());
+    std::remove("rom.state");
+}
+
+TEST_F(Chip8Fixture, Test_rewind)
+{
+    w.writeOp(0x7101);
+    w.writeOp(0xA300);
+    w.writeOp(0xF155);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    Chip8Rewind rewind(Chip8Rewind::MIN_BUDGET_B);
+    std::vector<Chip8State> states;
+    for (unsigned frame = 0; frame < 2*Chip8Rewind::KEYFRAME_PERIOD; frame++)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            chip8.emulateCycle();
+        }
+        states.emplace_back();
+        chip8.saveState(states.back());
+        rewind.record(states.back());
+    }
+
+    // across a keyframe and then back one frame at a time
+    Chip8State state{};
+    EXPECT_EQ(400, rewind.rewind(400, state));
+    EXPECT_EQ(0, std::memcmp(&states[199], &state, sizeof(state)));
+    EXPECT_EQ(1, rewind.rewind(1, state));
+    EXPECT_EQ(0, std::memcmp(&states[198], &state, sizeof(state)));
+
+    // recording continues from the frame rewound to
+    chip8.loadState(state);
+    chip8.emulateCycle();
+    chip8.saveState(state);
+    rewind.record(state);
+    EXPECT_EQ(199, rewind.getDepth());
+    EXPECT_EQ(1, rewind.rewind(1, state));
+    EXPECT_EQ(0, std::memcmp(&states[198], &state, sizeof(state)));
+}
+
+TEST_F(Chip8Fixture, Test_fork)
+{
+    w.writeOp(0xA300);
+    w.writeOp(0x6105);
+    w.writeOp(0xF155);
+    w.writeOp(0x1206);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.emulateCycle();
+    chip8.emulateCycle();
+    Chip8Fork root;
+    chip8.fork(root);
+
+    // Fx55 writes 0x300-0x301, only that page stops being shared
+    chip8.emulateCycle();
+    Chip8Fork child;
+    chip8.fork(child);
+    EXPECT_EQ(Chip8Fork::PAGE_CNT - 1, root.countSharedPages(child));
+
+    chip8.loadFork(root);
+    EXPECT_EQ(0x204, chip8.getPC());
+    EXPECT_EQ(0, chip8.readByte(0x301));
+    chip8.loadFork(child);
+    EXPECT_EQ(0x206, chip8.getPC());
+    EXPECT_EQ(5, chip8.readByte(0x301));
+
+    // a fork of an unmodified fork shares every page with it
+    Chip8Fork grandchild;
+    chip8.fork(grandchild);
+    EXPECT_EQ(Chip8Fork::PAGE_CNT, child.countSharedPages(grandchild));
+}
+
+TEST_F(Chip8Fixture, Test_state_hash)
+{
+    w.writeOp(0xA300);
+    w.writeOp(0x7101);
+    w.writeOp(0xF155);
+    w.writeOp(0xD005);
+    w.writeOp(0x1202);
+    w.done();
+    chip8.loadRom(w.filename);
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        chip8.emulateCycle();
+        chip8.stateHash();
+    }
+    Chip8Fork fork;
+    chip8.fork(fork);
+    uint64_t hash = chip8.stateHash();
+
+    // loading a state hashes everything again, it has to match the
+    // incrementally updated hash
+    Chip8State state;
+    chip8.saveState(state);
+    chip8.loadState(state);
+    EXPECT_EQ(hash, chip8.stateHash());
+
+    // the cycle count is not part of the hash, memory is
+    state.cycleCnt += 1000;
+    chip8.loadState(state);
+    EXPECT_EQ(hash, chip8.stateHash());
+    state.memory[0x400] ^= 1;
+    chip8.loadState(state);
+    EXPECT_NE(hash, chip8.stateHash());
+    state.memory[0x400] ^= 1;
+
+    // entries RET popped are not, the ones still on the stack are
+    ASSERT_EQ(Chip8::SP_RESET_VALUE, chip8.getSP());
+    state.stack[0] = 0x345;
+    chip8.loadState(state);
+    EXPECT_EQ(hash, chip8.stateHash());
+    state.sp = 0;
+    chip8.loadState(state);
+    EXPECT_NE(hash, chip8.stateHash());
+
+    chip8.emulateCycle();
+    chip8.loadFork(fork);
+    EXPECT_EQ(hash, chip8.stateHash());
+}
+
+TEST_F(Chip8Fixture, Test_movie)
+{
+    w.writeOp(0xC0FF);
+    w.writeOp(0xE19E);
+    w.writeOp(0x7201);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(42);
+
+    // one frame is the keys, 9 cycles and a timer tick, as in the runner
+    auto runFrame = [](uint16_t keys)
+    {
+        chip8.setKeys(keys);
+        for (uint8_t i = 0; i < 9; i++)
+        {
+            chip8.emulateCycle();
+        }
+        chip8.decrementTimers();
+    };
+    Chip8Movie movie(chip8.getRomHash(), chip8.getRandomSeed(), chip8.getRandomStream(), 540);
+    for (uint16_t frame = 0; frame < 20; frame++)
+    {
+        uint16_t keys = (frame % 3) ? 0x0001 : 0x0000;
+        movie.record(keys);
+        runFrame(keys);
+    }
+    movie.setFinalStateHash(chip8.stateHash());
+    movie.save("rom.movie");
+
+    Chip8Movie replay("rom.movie");
+    EXPECT_EQ(20, replay.getFrameCount());
+    EXPECT_EQ(42, replay.getSeed());
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(replay.getSeed());
+    for (uint64_t frame = 0; frame < replay.getFrameCount(); frame++)
+    {
+        runFrame(replay.getKeys(frame));
+    }
+    EXPECT_EQ(replay.getFinalStateHash(), chip8.stateHash());
+
+    // another seed draws other numbers
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(43);
+    for (uint64_t frame = 0; frame < replay.getFrameCount(); frame++)
+    {
+        runFrame(replay.getKeys(frame));
+    }
+    EXPECT_NE(replay.getFinalStateHash(), chip8.stateHash());
+
+    // frames run ahead on a fork or rewound to a saved state draw from the
+    // generator in the state, the movie still replays
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(replay.getSeed());
+    Chip8Fork fork;
+    Chip8State state;
+    for (uint64_t frame = 0; frame < replay.getFrameCount(); frame++)
+    {
+        chip8.fork(fork);
+        runFrame(0xFFFF);
+        runFrame(0xFFFF);
+        chip8.loadFork(fork);
+        chip8.saveState(state);
+        runFrame(0x0000);
+        chip8.loadState(state);
+        runFrame(replay.getKeys(frame));
+    }
+    EXPECT_EQ(replay.getFinalStateHash(), chip8.stateHash());
+
+    // the frame count in the header has to match the file
+    std::fstream file("rom.movie", std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t frameCnt = UINT64_MAX/2;
+    file.seekp(offsetof(Chip8Movie::FileHeader, frameCnt));
+    file.write(reinterpret_cast<const char*>(&frameCnt), sizeof(frameCnt));
+    file.close();
+    EXPECT_THROW(Chip8Movie("rom.movie"), std::runtime_error);
+    std::remove("rom.movie");
+}
+
+TEST_F(Chip8Fixture, Test_search)
+{
+    // waits for key 5, then for key 3, then stores V0-V1 at 0x300
+    w.writeOp(0x6005);
+    w.writeOp(0x6103);
+    w.writeOp(0xE09E);
+    w.writeOp(0x1204);
+    w.writeOp(0xE19E);
+    w.writeOp(0x1208);
+    w.writeOp(0xA300);
+    w.writeOp(0xF155);
+    w.writeOp(0x1210);
+    w.done();
+
+    auto params = Chip8Search::defaultParams();
+    params.threads = 2;
+    params.maxDepth = 4;
+    Chip8Search search(params);
+    auto result = search.run(w.filename, Chip8Search::goalFromString("mem:0x301=3"));
+    ASSERT_TRUE(result.isFound);
+    EXPECT_EQ(2, result.depth);
+    EXPECT_EQ((std::vector<uint16_t>{1 << 5, 1 << 3}), result.frameKeys);
+
+    // the keys replay from reset into the state the search found
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(params.seed, params.stream);
+    for (auto keys : result.frameKeys)
+    {
+        chip8.setKeys(keys);
+        chip8.emulateFrame(9);
+    }
+    EXPECT_EQ(3, chip8.readByte(0x301));
+    EXPECT_EQ(result.finalStateHash, chip8.stateHash());
+
+    // the waiting loops come back to states already seen
+    auto unreachable = search.run(w.filename, Chip8Search::goalFromString("mem:0x301>3"));
+    EXPECT_FALSE(unreachable.isFound);
+    EXPECT_EQ(4, unreachable.depth);
+    EXPECT_GT(unreachable.duplicates, 0);
+
+    EXPECT_THROW(Chip8Search::goalFromString("mem:0x1000=1"), std::runtime_error);
+    EXPECT_THROW(Chip8Search::goalFromString("pixel:3"), std::runtime_error);
+}
+
+TEST_F(Chip8Fixture, Test_frame_cache)
+{
+    // blinks a digit every time DT runs out, an attract mode in 8 opcodes
+    w.writeOp(0xA050);
+    w.writeOp(0x6003);
+    w.writeOp(0xF015);
+    w.writeOp(0xD125);
+    w.writeOp(0xF307);
+    w.writeOp(0x3300);
+    w.writeOp(0x1208);
+    w.writeOp(0x1202);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(0);
+    std::vector<uint64_t> hashes;
+    for (uint16_t frame = 0; frame < 100; frame++)
+    {
+        chip8.emulateFrame(9);
+        hashes.push_back(chip8.stateHash());
+    }
+    uint64_t cycles = chip8.getCycleCount();
+
+    // the cached run goes through the same states and cycle counts
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    chip8.setRandomSeed(0);
+    Chip8FrameCache cache(9, 64);
+    for (uint16_t frame = 0; frame < 100; frame++)
+    {
+        cache.runFrameCycles(chip8);
+        chip8.decrementTimers();
+        ASSERT_EQ(hashes[frame], chip8.stateHash()) << "frame " << frame;
+    }
+    EXPECT_EQ(cycles, chip8.getCycleCount());
+    EXPECT_GT(cache.getStats().hits, 80);
+    EXPECT_EQ(100, cache.getStats().hits + cache.getStats().misses);
+
+    // the loop is longer than a small cache, the least recently used entry
+    // makes room for every new one
+    Chip8FrameCache small(9, 2);
+    for (uint16_t frame = 0; frame < 20; frame++)
+    {
+        small.runFrameCycles(chip8);
+        chip8.decrementTimers();
+    }
+    EXPECT_EQ(2, small.size());
+    EXPECT_GT(small.getStats().evictions, 0);
+    EXPECT_THROW(Chip8FrameCache(9, 0), std::runtime_error);
+}
+
+TEST_F(Chip8Fixture, Test_random_seed)
+{
+    w.writeOp(0xC0FF);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    auto draw = [](unsigned cnt)
+    {
+        std::vector<uint8_t> numbers;
+        for (unsigned i = 0; i < cnt; i++)
+        {
+            chip8.emulateCycle();
+            chip8.emulateCycle();
+            numbers.push_back(chip8.getV(0));
+        }
+        return numbers;
+    };
+
+    chip8.setRandomSeed(7, 1);
+    auto first = draw(16);
+    chip8.setRandomSeed(7, 1);
+    EXPECT_EQ(first, draw(16));
+    chip8.setRandomSeed(7, 2);
+    EXPECT_NE(first, draw(16));
+
+    // the generator is part of the state
+    chip8.setRandomSeed(7, 1);
+    Chip8State state;
+    chip8.saveState(state);
+    draw(8);
+    chip8.loadState(state);
+    EXPECT_EQ(first, draw(16));
+
+    // and restarts on reset
+    chip8.reset();
+    chip8.loadRom(w.filename);
+    EXPECT_EQ(7, chip8.getRandomSeed());
+    EXPECT_EQ(first, draw(16));
+}
+
+TEST_F(Chip8Fixture, Test_fault_stack)
+{
+    // a subroutine calling itself overflows the 16 entry stack
+    w.writeOp(0x2200);
+    w.done();
+    chip8.loadRom(w.filename);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        chip8.emulateCycle();
+    }
+    try
+    {
+        chip8.emulateCycle();
+        FAIL() << "CALL with a full stack did not fault";
+    }
+    catch (const Chip8Fault& e)
+    {
+        EXPECT_EQ(Chip8Fault::Kind::STACK_OVERFLOW, e.getKind());
+        EXPECT_EQ(0x200, e.getPC());
+        EXPECT_EQ(0x2200, e.getOp());
+    }
+
+    chip8.reset();
+    w.reset();
+    w.writeOp(0x00EE);
+    w.done();
+    chip8.loadRom(w.filename);
+    EXPECT_THROW(chip8.emulateCycle(), Chip8Fault);
+}
+
+TEST_F(Chip8Fixture, Test_fault_illegal_opcode)
+{
+    w.writeOp(0x6A42);
+    w.writeOp(0xF0FF);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.emulateCycle();
+    try
+    {
+        chip8.emulateCycle();
+        FAIL() << "0xF0FF did not fault";
+    }
+    catch (const Chip8Fault& e)
+    {
+        EXPECT_EQ(Chip8Fault::Kind::ILLEGAL_OPCODE, e.getKind());
+        EXPECT_EQ(0x202, e.getPC());
+    }
+
+    // the report ends with the instructions leading to the fault
+    std::ostringstream report;
+    chip8.writeCrashReport(report);
+    auto text = report.str();
+    EXPECT_NE(std::string::npos, text.find("VA: 0x42"));
+    EXPECT_NE(std::string::npos, text.find("0x200: 0x6A42"));
+    EXPECT_NE(std::string::npos, text.find("0x202: 0xF0FF"));
+}
+
+TEST_F(Chip8Fixture, Test_trace_dump)
+{
+    w.writeOp(0x7101);
+    w.writeOp(0x1200);
+    w.done();
+    chip8.loadRom(w.filename);
+    {
+        Chip8TraceRecorder recorder("rom.trace", 16);
+        for (uint8_t i = 0; i < 10; i++)
+        {
+            recorder.emulateCycle(chip8);
+        }
+    }
+    Chip8TraceReader trace("rom.trace");
+    auto countLines = [&trace](uint64_t skip, uint64_t count)
+    {
+        std::ostringstream os;
+        trace.dump(os, skip, count);
+        auto text = os.str();
+        return std::count(text.begin(), text.end(), '\n') - 1;
+    };
+
+    // --skip on its own prints everything after the skipped records
+    EXPECT_EQ(3, countLines(7, UINT64_MAX));
+    EXPECT_EQ(2, countLines(7, 2));
+    EXPECT_EQ(10, countLines(0, UINT64_MAX));
+    EXPECT_EQ(0, countLines(12, UINT64_MAX));
+    std::remove("rom.trace");
+}
+
+TEST_F(Chip8Fixture, Test_profiler_blocks)
+{
+    // the skip is never taken, so 0x204 is only reached by falling through
+    const std::vector<uint16_t> rom{0x6000, 0x3001, 0x7101, 0x1202};
+    std::array<uint8_t, Chip8Profiler::MEMORY_SIZE_B> memory{};
+    for (std::size_t i = 0; i < rom.size(); i++)
+    {
+        w.writeOp(rom[i]);
+        memory[0x200 + 2*i] = static_cast<uint8_t>(rom[i] >> 8);
+        memory[0x200 + 2*i + 1] = static_cast<uint8_t>(rom[i]);
+    }
+    w.done();
+    chip8.loadRom(w.filename);
+
+    Chip8Profiler profiler;
+    for (uint16_t i = 0; i < 301; i++)
+    {
+        auto pc = chip8.getPC();
+        profiler.record(pc, static_cast<uint16_t>((memory[pc] << 8) | memory[pc + 1]));
+        chip8.emulateCycle();
+    }
+
+    std::ostringstream os;
+    profiler.report(os, memory);
+    auto text = os.str();
+    auto blocks = text.substr(text.find("basic blocks\n"));
+    EXPECT_NE(std::string::npos, blocks.find("0x204-0x206 entries: 100 instructions: 200 (66.445%)\n"));
+    EXPECT_NE(std::string::npos, blocks.find("0x202-0x202 entries: 99 instructions: 100 (33.223%)\n"));
+    EXPECT_NE(std::string::npos, blocks.find("0x200-0x200 entries: 1 instructions: 1 (0.332%)\n"));
+}
+
+TEST_F(Chip8Fixture, Test_coverage)
+{
+    auto readFile = [](const std::string& path)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    };
+
+    // an instruction counts for both of its bytes, also across the wrap
+    // from 0xFFF to 0x000
+    Chip8Coverage coverage;
+    coverage.execute(0x200);
+    coverage.execute(0x200);
+    coverage.execute(0xFFF);
+    coverage.read(0x300, 2);
+    coverage.write(0x201, 1);
+    EXPECT_TRUE(coverage.isSelfModified(0x201));
+    EXPECT_FALSE(coverage.isSelfModified(0x200));
+    EXPECT_FALSE(coverage.isSelfModified(0x300));
+    coverage.save("rom.coverage");
+    EXPECT_EQ(
+            "addr,exec,read,write,self_modified\n"
+            "0x000,1,0,0,0\n"
+            "0x200,2,0,0,0\n"
+            "0x201,2,0,1,1\n"
+            "0x300,0,1,0,0\n"
+            "0x301,0,1,0,0\n"
+            "0xFFF,1,0,0,0\n",
+            readFile("rom.coverage.csv"));
+    EXPECT_EQ(0, readFile("rom.coverage.pgm").rfind("P5\n194 64\n255\n", 0));
+    std::remove("rom.coverage.csv");
+    std::remove("rom.coverage.pgm");
+
+    if (not Chip8CoveragePolicy::IS_ENABLED)
+    {
+        EXPECT_THROW(chip8.writeCoverage("rom.coverage"), std::runtime_error);
+        GTEST_SKIP() << "Coverage of a running ROM needs -DBUILD_COVERAGE_PACKAGE=ON";
+    }
+
+    // Fx55 writes ADD V1, 5 to 0x208 before it executes, Fx65 reads it back
+    w.writeOp(0xA208);
+    w.writeOp(0x6071);
+    w.writeOp(0x6105);
+    w.writeOp(0xF155);
+    w.writeOp(0x0000);
+    w.writeOp(0xF065);
+    w.writeOp(0x120C);
+    w.done();
+    chip8.loadRom(w.filename);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        chip8.emulateCycle();
+    }
+    EXPECT_EQ(5 + 5, chip8.getV(1));
+    chip8.writeCoverage("rom.coverage");
+    EXPECT_EQ(
+            "addr,exec,read,write,self_modified\n"
+            "0x200,1,0,0,0\n"
+            "0x201,1,0,0,0\n"
+            "0x202,1,0,0,0\n"
+            "0x203,1,0,0,0\n"
+            "0x204,1,0,0,0\n"
+            "0x205,1,0,0,0\n"
+            "0x206,1,0,0,0\n"
+            "0x207,1,0,0,0\n"
+            "0x208,1,1,1,1\n"
+            "0x209,1,0,1,1\n"
+            "0x20A,1,0,0,0\n"
+            "0x20B,1,0,0,0\n"
+            "0x20C,2,0,0,0\n"
+            "0x20D,2,0,0,0\n",
+            readFile("rom.coverage.csv"));
+    std::remove("rom.coverage.csv");
+    std::remove("rom.coverage.pgm");
+}
+
+TEST_F(Chip8Fixture, Test_speculative_cycles)
+{
+    w.writeOp(0x6A42);
+    w.writeOp(0x7B01);
+    w.writeOp(0xF0FF);
+    w.done();
+    chip8.loadRom(w.filename);
+    chip8.setCrashDumpPath("rom.crash");
+    std::remove("rom.crash");
+    chip8.emulateCycle();
+    Chip8Fork fork;
+    chip8.fork(fork);
+
+    // run-ahead into the fault: thrown, but no dump and nothing recorded
+    chip8.setSpeculative(true);
+    chip8.emulateCycle();
+    EXPECT_THROW(chip8.emulateCycle(), Chip8Fault);
+    chip8.setSpeculative(false);
+    chip8.loadFork(fork);
+    EXPECT_FALSE(std::ifstream("rom.crash").good());
+    std::ostringstream report;
+    chip8.writeCrashReport(report);
+    EXPECT_NE(std::string::npos, report.str().find("last 1 instructions"));
+    EXPECT_EQ(std::string::npos, report.str().find("0x202: 0x7B01"));
+
+    // the real run reports the fault with only the committed instructions
+    chip8.emulateCycle();
+    EXPECT_THROW(chip8.emulateCycle(), Chip8Fault);
+    std::ifstream dump("rom.crash");
+    std::stringstream text;
+    text << dump.rdbuf();
+    EXPECT_NE(std::string::npos, text.str().find("last 3 instructions"));
+    chip8.setCrashDumpPath("");
+    std::remove("rom.crash");
+}
+
+TEST_F(Chip8Fixture, Test_input_script)
+{
+    auto writeScript = [](const std::string& text)
+    {
+        std::ofstream script("rom.input");
+        script << text;
+    };
+    auto loadError = [](void)
+    {
+        try
+        {
+            InputScript script("rom.input");
+        }
+        catch (const std::runtime_error& e)
+        {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    // events are sorted by frame, in the order written within a frame
+    writeScript("# comment\n2 5 down\n\n  1 A down\n2 5 up\n1 0 down\n");
+    InputScript script("rom.input");
+    const auto& events = script.getEvents();
+    ASSERT_EQ(4, events.size());
+    EXPECT_EQ(1, events[0].frame);
+    EXPECT_EQ(0xA, events[0].key);
+    EXPECT_EQ(0x0, events[1].key);
+    EXPECT_EQ(0x5, events[2].key);
+    EXPECT_TRUE(events[2].isPressed);
+    EXPECT_FALSE(events[3].isPressed);
+
+    script.apply(1, chip8);
+    EXPECT_TRUE(chip8.getKey(0xA));
+    EXPECT_FALSE(chip8.getKey(0x5));
+    script.apply(2, chip8);
+    EXPECT_FALSE(chip8.getKey(0x5));
+    EXPECT_TRUE(script.isDone());
+
+    writeScript("1 G down\n");
+    EXPECT_EQ("rom.input:1: key must be a hex digit, got 'G'", loadError());
+    writeScript("\n1 5x down\n");
+    EXPECT_EQ("rom.input:2: key must be a hex digit, got '5x'", loadError());
+    writeScript("1 10 down\n");
+    EXPECT_EQ("rom.input:1: key 0x10 is outside [0, 0xF]", loadError());
+    writeScript("1 5 pressed\n");
+    EXPECT_EQ("rom.input:1: key state must be 'down' or 'up', got 'pressed'", loadError());
+    writeScript("one 5 down\n");
+    EXPECT_EQ("rom.input:1: expected '<frame> <key> <down|up>', got 'one 5 down'", loadError());
+    std::remove("rom.input");
+    EXPECT_THROW(InputScript("rom.input"), std::runtime_error);
+}
+
+TEST_F(Chip8Fixture, Test_headless_frames)
+{
+    // DT = 5, then V0 counts up forever
+    w.writeOp(0x6005);
+    w.writeOp(0xF015);
+    w.writeOp(0x7001);
+    w.writeOp(0x1204);
+    w.done();
+    {
+        std::ofstream script("rom.input");
+        script << "2 5 down\n3 5 up\n";
+    }
+    auto report = [](const Chip8Headless& emu)
+    {
+        std::ostringstream os;
+        emu.printReport(os);
+        return os.str();
+    };
+
+    Chip8Headless emu(540);
+    ASSERT_EQ(9, emu.getCyclesPerFrame());
+    emu.loadRom(w.filename);
+    emu.loadInputScript("rom.input");
+
+    // a partial frame is finished first, then whole frames run
+    emu.runCycles(4);
+    EXPECT_EQ(0, emu.getFrameCount());
+    emu.runFrames(1);
+    EXPECT_EQ(1, emu.getFrameCount());
+    EXPECT_EQ(9, emu.getCpu().getCycleCount());
+    EXPECT_NE(std::string::npos, report(emu).find("DT: 0x04\n"));
+    emu.runFrames(1);
+    EXPECT_EQ(18, emu.getCpu().getCycleCount());
+    EXPECT_FALSE(emu.getCpu().getKey(0x5));
+
+    // the script is applied at the start of the frame it names
+    emu.runCycles(1);
+    EXPECT_TRUE(emu.getCpu().getKey(0x5));
+    emu.runFrames(1);
+    EXPECT_EQ(3, emu.getFrameCount());
+    EXPECT_TRUE(emu.getCpu().getKey(0x5));
+    emu.runCycles(5);
+    EXPECT_FALSE(emu.getCpu().getKey(0x5));
+    EXPECT_NE(std::string::npos, report(emu).find("DT: 0x02\n"));
+
+    // a state saved mid frame resumes in the same frame and phase
+    emu.saveState("rom.state");
+    emu.runFrames(2);
+    Chip8Headless resumed(540);
+    resumed.loadRom(w.filename);
+    resumed.loadState("rom.state");
+    EXPECT_EQ(3, resumed.getFrameCount());
+    resumed.runFrames(2);
+    EXPECT_EQ(5, resumed.getFrameCount());
+    EXPECT_EQ(45, resumed.getCpu().getCycleCount());
+    auto stateHash = [&report](const Chip8Headless& emu)
+    {
+        auto text = report(emu);
+        auto start = text.find("state_hash: ");
+        return text.substr(start, text.find('\n', start) - start);
+    };
+    EXPECT_EQ(stateHash(emu), stateHash(resumed));
+    std::remove("rom.state");
+    std::remove("rom.input");
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "Metrics.hxx"
+#include "MetricsExporter.hxx"
+
+struct MetricsFixture : public ::testing::Test
+{
+    Metrics metrics;
+};
+
+TEST_F(MetricsFixture, TestHistogramBuckets)
+{
+    auto& histogram = metrics.addHistogram("latency_seconds", "Latency", {1.0, 2.0, 5.0});
+    // a bound is inclusive, above the last one only +Inf counts it
+    for (double value : {0.5, 1.0, 1.5, 7.0})
+    {
+        histogram.observe(value);
+    }
+    std::ostringstream os;
+    histogram.write(os, "latency_seconds");
+    EXPECT_EQ(
+            "latency_seconds_bucket{le=\"1\"} 2\n"
+            "latency_seconds_bucket{le=\"2\"} 3\n"
+            "latency_seconds_bucket{le=\"5\"} 3\n"
+            "latency_seconds_bucket{le=\"+Inf\"} 4\n"
+            "latency_seconds_sum 10\n"
+            "latency_seconds_count 4\n",
+            os.str());
+
+    EXPECT_THROW(Metrics::Histogram({2.0, 1.0}), std::runtime_error);
+}
+
+TEST_F(MetricsFixture, TestTextExposition)
+{
+    metrics.addCounter("chip8_cycles_total", "Instructions executed").add(42);
+    metrics.addGauge("chip8_effective_clock_hz", "Instructions per second").set(540.5);
+    metrics.addHistogram("chip8_frame_time_seconds", "Frame time", {0.01}).observe(0.02);
+    std::ostringstream os;
+    metrics.write(os);
+    EXPECT_EQ(
+            "# HELP chip8_cycles_total Instructions executed\n"
+            "# TYPE chip8_cycles_total counter\n"
+            "chip8_cycles_total 42\n"
+            "# HELP chip8_effective_clock_hz Instructions per second\n"
+            "# TYPE chip8_effective_clock_hz gauge\n"
+            "chip8_effective_clock_hz 540.5\n"
+            "# HELP chip8_frame_time_seconds Frame time\n"
+            "# TYPE chip8_frame_time_seconds histogram\n"
+            "chip8_frame_time_seconds_bucket{le=\"0.01\"} 0\n"
+            "chip8_frame_time_seconds_bucket{le=\"+Inf\"} 1\n"
+            "chip8_frame_time_seconds_sum 0.02\n"
+            "chip8_frame_time_seconds_count 1\n",
+            os.str());
+}
+
+TEST_F(MetricsFixture, TestExportFile)
+{
+    auto& cycles = metrics.addCounter("chip8_cycles_total", "Instructions executed");
+    {
+        MetricsExporter exporter(metrics, "metrics.prom", std::chrono::milliseconds(1000));
+        cycles.add(7);
+        exporter.flush();
+        std::ifstream file("metrics.prom");
+        std::stringstream text;
+        text << file.rdbuf();
+        EXPECT_NE(std::string::npos, text.str().find("chip8_cycles_total 7\n"));
+    }
+    std::remove("metrics.prom");
+
+    EXPECT_THROW(MetricsExporter(metrics, "metrics.prom", std::chrono::milliseconds(0)), std::runtime_error);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <fmt/core.h>
+#include <vector>
+
+#include "Chip8.hxx"
+#include "WorkloadGenerator.hxx"
+
+Chip8 chip8;
+
+struct WorkloadFixture : public ::testing::Test
+{
+    void SetUp(void)
+    {
+        chip8.reset();
+    }
+};
+
+TEST_F(WorkloadFixture, TestExpectedCycles)
+{
+    using Kind = WorkloadGenerator::Kind;
+    // 300 iterations make the low byte of the loop counter wrap twice
+    for (auto kind : {Kind::ALU, Kind::DRW, Kind::CALL, Kind::SMC})
+    {
+        for (uint16_t iterations : {1, 255, 256, 300})
+        {
+            chip8.reset();
+            auto workload = WorkloadGenerator::generate({kind, iterations, 3, 4, 7});
+            chip8.loadRom(workload.rom);
+
+            std::string err = fmt::format("kind: {}, iterations: {}", 
+                    WorkloadGenerator::kindToString(kind), iterations);
+
+            ASSERT_NE(0, workload.expectedCycles) << err;
+            for (uint64_t cycle = 0; cycle < workload.expectedCycles; cycle++)
+            {
+                ASSERT_FALSE(chip8.isHalted()) << err << fmt::format(", cycle: {}", cycle);
+                chip8.emulateCycle();
+            }
+            EXPECT_TRUE(chip8.isHalted()) << err;
+            EXPECT_EQ(workload.haltAddr, chip8.getPC()) << err;
+        }
+    }
+}
+
+TEST_F(WorkloadFixture, TestTimerWorkloadHalts)
+{
+    auto workload = WorkloadGenerator::generate({WorkloadGenerator::Kind::TIMER, 4, 2, 3, 0});
+    chip8.loadRom(workload.rom);
+    for (auto frame = 0; (frame < 1000) and not chip8.isHalted(); frame++)
+    {
+        chip8.emulateFrame(9);
+    }
+    EXPECT_TRUE(chip8.isHalted());
+    EXPECT_EQ(0, chip8.getDelayTimer());
+}
+
+TEST_F(WorkloadFixture, TestDeterministicFinalState)
+{
+    auto workload = WorkloadGenerator::generate({WorkloadGenerator::Kind::DRW, 500, 4, 7, 42});
+
+    std::vector<uint8_t> registers;
+    uint64_t gfxHash = 0;
+    for (auto run = 0; run < 2; run++)
+    {
+        chip8.reset();
+        chip8.loadRom(workload.rom);
+        for (uint64_t cycle = 0; cycle < workload.expectedCycles; cycle++)
+        {
+            chip8.emulateCycle();
+        }
+
+        std::vector<uint8_t> current;
+        for (uint8_t i = 0; i < Chip8::REGISTER_CNT; i++)
+        {
+            current.push_back(chip8.getV(i));
+        }
+        if (0 == run)
+        {
+            registers = current;
+            gfxHash = chip8.gfxHash();
+        }
+        else
+        {
+            EXPECT_EQ(registers, current);
+            EXPECT_EQ(gfxHash, chip8.gfxHash());
+        }
+    }
+}
+
+TEST_F(WorkloadFixture, TestParamsFromString)
+{
+    auto params = WorkloadGenerator::paramsFromString("call:12:3:4:5");
+    EXPECT_EQ(WorkloadGenerator::Kind::CALL, params.kind);
+    EXPECT_EQ(12, params.iterations);
+    EXPECT_EQ(3, params.unroll);
+    EXPECT_EQ(4, params.param);
+    EXPECT_EQ(5, params.seed);
+
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("nop"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("alu:70000"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("alu:10:300"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("drw:10:8:256"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("alu:10:8:5:4294967296"), std::runtime_error);
+    try
+    {
+        WorkloadGenerator::paramsFromString("alu:ten");
+        ADD_FAILURE() << "A non-numeric field was accepted";
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_STREQ("Bad workload 'alu:ten', iterations must be a number, got 'ten'", e.what());
+    }
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("alu:10:8x"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::paramsFromString("alu::8"), std::runtime_error);
+    EXPECT_THROW(WorkloadGenerator::generate({WorkloadGenerator::Kind::ALU, 1, 255, 0, 0}), 
+            std::runtime_error);
+}